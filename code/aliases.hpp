@@ -3,24 +3,48 @@
 
 #include <complex>
 #include <vector>
+#include <array>
+#include <type_traits>
 #include <png++/png.hpp>
 
+#include "structs.hpp"
+#include "lyap_exp_matrix.hpp"
+#include "color_lut.hpp"
+
+template<typename T>
 using map_fn_ptr_t =
-    std::complex<long double> (*)(const std::complex<long double>& x,
-                                  const std::complex<long double>& r);
+    std::complex<T> (*)(const std::complex<T>& x,
+                        const std::complex<T>& r);
+template<typename T>
 using map_der_fn_ptr_t =
-    std::complex<long double> (*)(const std::complex<long double>& x,
-                                  const std::complex<long double>& r);
+    std::complex<T> (*)(const std::complex<T>& x,
+                        const std::complex<T>& r);
+template<typename T>
+using real_map_fn_ptr_t =
+    T (*)(const T& x, const T& r);
+template<typename T>
+using real_map_der_fn_ptr_t =
+    T (*)(const T& x, const T& r);
+//Values of r for every element of the sequence: fixed size array for the exponent calculators specialized
+//on the length of the sequence, vector for the generic ones (period == 0)
+template<typename T, size_t period>
+using rx_values_t = std::conditional_t<period == 0, std::vector<T>, std::array<T, period>>;
+
+//States of the orbits of all the pixels
+using orbit_matrix_t = matrix_t<orbit_state_t>;
+
 using block_exp_calc_fn_ptr_t =
-    void (*)(const size_t& img_widht,   const size_t& img_height,
+    blockstats_t (*)(const size_t& img_widht,   const size_t& img_height,
              const size_t& start_x,     const size_t& start_y,
              const size_t& end_x,       const size_t& end_y,
-             std::vector<std::vector<long double>>& lyap_exp_matr);
+             const size_t& max_iter,
+             lyap_exp_matrix_t& lyap_exp_matr,
+             orbit_matrix_t* orbits);
 
 using block_renderer_fn_ptr_t =
     void (*)(const size_t& start_x,      const size_t& start_y,
              const size_t& end_x,        const size_t& end_y,
-             const long double& max_pos, const long double& min_neg,
-             std::vector<std::vector<long double>>& lyap_exp_matr,
-             png::image<png::rgb_pixel>& image_to_color);
+             const std::vector<color_lut_t>& luts,
+             const lyap_exp_matrix_t& lyap_exp_matr,
+             std::vector<png::image<png::rgb_pixel>>& images_to_color);
 #endif
\ No newline at end of file
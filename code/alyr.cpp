@@ -15,6 +15,8 @@ std::vector<rxtype>     alyr::internals::rx_sequence{rxtype::A, rxtype::B};
 std::vector<png::rgb_pixel> alyr::internals::npalette{};
 std::vector<png::rgb_pixel> alyr::internals::ppalette{};
 
+std::vector<recolor_variant_t> alyr::internals::recolor_variants{};
+
 //Initialize the number of threads to use in the render, can be changed later
 void alyr::init(){
     size_t max_t = std::thread::hardware_concurrency();
@@ -24,6 +26,11 @@ void alyr::init(){
     internals::rsettings.max_threads = max_t;
 }
 
+//True if the real exponent calculators have a version unrolled over sequences of length seq_len
+static bool has_unrolled_kernel(const size_t& seq_len){
+    return seq_len == 2 || seq_len == 3 || seq_len == 4 || seq_len == 12;
+}
+
 //Print various information about the current render
 void alyr::internals::print_render_info(){
     using std::cout;
@@ -43,7 +50,25 @@ void alyr::internals::print_render_info(){
     cout << map_type_str << endl;
 
     //Floating point variable used
-    cout << "Float type     : long double (" << sizeof(long double) << " bytes)" << endl;
+    cout << "Float type     : " << float_type_str() << endl;
+
+    //Kernel used
+    cout << "Kernel         : " << (fsettings.x0.imag() == 0 ? "real" : "complex");
+#if ALYR_SIMD_BYTES > 0
+    if(fsettings.x0.imag() == 0 &&
+       ((rsettings.float_type == ftype::float32 && simd_kernel_available<float>()) ||
+        (rsettings.float_type == ftype::float64 && simd_kernel_available<double>())))
+        cout << ", SIMD (" << ALYR_SIMD_BYTES * 8 << " bit)";
+#endif
+    if(fsettings.x0.imag() == 0 && has_unrolled_kernel(rx_sequence.size()))
+        cout << ", unrolled sequence";
+    cout << endl;
+
+    //Accumulation of the exponent
+    cout << "Accumulation   : " << (rsettings.exp_accumulation == accumulation_mode::product ? "product" : "log") << endl;
+
+    //Storage of the exponents
+    cout << "Storage        : " << storage_type_str() << endl;
 
     //Sequence used
     cout << "Sequence       : ";
@@ -65,6 +90,10 @@ void alyr::internals::print_render_info(){
     //Iterations
     cout << "Iterations     : " << rsettings.max_iter << endl;
     cout << "Transient iter.: " << rsettings.transient_iter << endl;
+    if(rsettings.cycle_tolerance > 0 && fsettings.x0.imag() == 0)
+        cout << "Cycle detection: tolerance " << rsettings.cycle_tolerance << endl;
+    if(rsettings.convergence_tolerance > 0 && fsettings.x0.imag() == 0)
+        cout << "Convergence    : tolerance " << rsettings.convergence_tolerance << ", checked every " << rsettings.convergence_interval << " iter." << endl;
 
     //Limits of ra, rb and rc
     cout << "Limits of ra   : [" << fsettings.min_ra << ", " << fsettings.max_ra << "], span : " << fsettings.max_ra - fsettings.min_ra << endl;
@@ -80,10 +109,133 @@ void alyr::internals::print_warning(const std::string& msg){
     std::cout << "[WARN] : " << msg << "\n";
 }
 
-//Function to return a function pointer to a block renderer depending on the settings
-block_exp_calc_fn_ptr_t alyr::internals::get_block_exp_calc_ptr(){
+//Select the exponent calculator for a real x0, for the floating point type T, the accumulation mode acc_mode
+//and sequences of length period (0 for any length)
+template<typename T, accumulation_mode acc_mode, size_t period>
+static block_exp_calc_fn_ptr_t select_real_block_exp_calc_ptr(){
+    using namespace alyr::internals;
+
+    //Vectorize over multiple pixels if the vector units fit enough values of type T
+#if ALYR_SIMD_BYTES > 0
+    if constexpr (simd_kernel_available<T>())
+        return &block_exp_calculator_simd<
+            T, acc_mode, period,
+            &logmap<simd_vec<T>>,
+            &logmap_der<simd_vec<T>>
+        >;
+#endif
+
+    return &block_exp_calculator_real<
+        T, acc_mode, period,
+        &logmap<T>,
+        &logmap_der<T>
+    >;
+}
+
+//Select the exponent calculator for the floating point type T and the accumulation mode acc_mode,
+//depending on the value of x0
+template<typename T, accumulation_mode acc_mode>
+static block_exp_calc_fn_ptr_t select_block_exp_calc_ptr(){
+    using namespace alyr::internals;
+
+    //If x0 is real the whole orbit stays real, so the scalar kernels can be used.
+    //The most common lengths of the sequence have their own kernels, unrolled over one full period
+    if(fsettings.x0.imag() == 0){
+        switch(rx_sequence.size()){
+            case 2:     return select_real_block_exp_calc_ptr<T, acc_mode, 2>();
+            case 3:     return select_real_block_exp_calc_ptr<T, acc_mode, 3>();
+            case 4:     return select_real_block_exp_calc_ptr<T, acc_mode, 4>();
+            case 12:    return select_real_block_exp_calc_ptr<T, acc_mode, 12>();
+            default:    return select_real_block_exp_calc_ptr<T, acc_mode, 0>();
+        }
+    }
+
+#ifdef ALYR_FLOAT128
+    //std::complex is not supported for __float128, the caller falls back to another type
+    if constexpr (std::is_same_v<T, float128_t>)
+        return nullptr;
+    else
+#endif
     return &block_exp_calculator<
-        &logmap<std::complex<long double>>,
-        &logmap_der<std::complex<long double>>
+        T, acc_mode,
+        &logmap<std::complex<T>>,
+        &logmap_der<std::complex<T>>
     >;
-}
\ No newline at end of file
+}
+
+//Select the exponent calculator for the floating point type T, depending on the accumulation mode
+template<typename T>
+static block_exp_calc_fn_ptr_t select_block_exp_calc_ptr(){
+    using namespace alyr::internals;
+
+    switch(rsettings.exp_accumulation){
+        case accumulation_mode::product:
+            return select_block_exp_calc_ptr<T, accumulation_mode::product>();
+
+        default:
+        case accumulation_mode::log:
+            return select_block_exp_calc_ptr<T, accumulation_mode::log>();
+    }
+}
+
+//Function to return a function pointer to a block renderer depending on the settings
+block_exp_calc_fn_ptr_t alyr::internals::get_block_exp_calc_ptr(){
+    //The complex exponent calculator iterates every orbit up to the maximum number of iterations
+    if(fsettings.x0.imag() != 0 && rsettings.cycle_tolerance > 0){
+        print_warning("cycle detection is only available for a real x0, it will be disabled");
+        rsettings.cycle_tolerance = 0;
+    }
+    if(fsettings.x0.imag() != 0 && rsettings.convergence_tolerance > 0){
+        print_warning("adaptive iterations are only available for a real x0, every pixel will be iterated "
+                      + std::to_string(rsettings.max_iter) + " times");
+        rsettings.convergence_tolerance = 0;
+    }
+
+    switch(rsettings.float_type){
+        case ftype::float32:
+            return select_block_exp_calc_ptr<float>();
+
+        case ftype::float64:
+            return select_block_exp_calc_ptr<double>();
+
+#ifdef ALYR_FLOAT128
+        case ftype::float128:
+            //std::complex is not supported for __float128, use the widest standard type instead
+            if(fsettings.x0.imag() != 0){
+                print_warning("__float128 doesn't support a complex x0, falling back to long double");
+                rsettings.float_type = ftype::long_double;
+                return select_block_exp_calc_ptr<long double>();
+            }
+
+            return select_block_exp_calc_ptr<float128_t>();
+#endif
+
+        default:
+        case ftype::long_double:
+            return select_block_exp_calc_ptr<long double>();
+    }
+}
+
+//Name and size of the floating point type used in the render
+std::string alyr::internals::float_type_str(){
+    switch(rsettings.float_type){
+        case ftype::float32:        return "float (" + std::to_string(sizeof(float)) + " bytes)";
+        case ftype::float64:        return "double (" + std::to_string(sizeof(double)) + " bytes)";
+#ifdef ALYR_FLOAT128
+        case ftype::float128:       return "__float128 (" + std::to_string(sizeof(float128_t)) + " bytes)";
+#endif
+        default:
+        case ftype::long_double:    return "long double (" + std::to_string(sizeof(long double)) + " bytes)";
+    }
+}
+
+//Name and size of the type used to store the exponents
+std::string alyr::internals::storage_type_str(){
+    switch(rsettings.exp_storage){
+        case storage_type::float32:     return "float (" + std::to_string(sizeof(float)) + " bytes)";
+        case storage_type::float16:     return "half (2 bytes)";
+        case storage_type::int16:       return "int16 (2 bytes), scale " + std::to_string(static_cast<double>(rsettings.storage_scale));
+        default:
+        case storage_type::long_double: return "long double (" + std::to_string(sizeof(long double)) + " bytes)";
+    }
+}
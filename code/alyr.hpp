@@ -3,12 +3,18 @@
 
 #include "structs.hpp"
 #include "aliases.hpp"
+#include "float_types.hpp"
+#include "simd.hpp"
 
 #include <vector>
 #include <array>
+#include <atomic>
+#include <limits>
 #include <string>
 #include <png++/png.hpp>
 
+class work_stealing_pool_t;
+
 namespace alyr{
     //Initialize the number of threads to use in the render, can be changed later
     //Implementation:   alyr.cpp
@@ -22,9 +28,14 @@ namespace alyr{
     //Implementation:   load_palettes.cpp
     int load_palettes();
 
+    //Load the variants of the batch recolor, if required
+    //Implementation:   load_recolor_batch.cpp
+    int load_recolor_batch();
+
     //Render the image
+    //Returns 0 if the render was succesful, 2 if some errors occurred
     //Implementation:   rendering.cpp and others
-    png::image<png::rgb_pixel> render();
+    int render(png::image<png::rgb_pixel>& fractal_image);
 
     namespace internals{
         //-------------------------------------------------------
@@ -40,6 +51,8 @@ namespace alyr{
         extern std::vector<png::rgb_pixel> npalette;    //negative palette
         extern std::vector<png::rgb_pixel> ppalette;    //positive palette
 
+        extern std::vector<recolor_variant_t> recolor_variants; //images colored in addition to the main one
+
         //-------------------------------------------------------
         //Private methods
 
@@ -47,6 +60,14 @@ namespace alyr{
         //Implementation:   alyr.cpp
         void print_render_info();
 
+        //Name and size of the floating point type used in the render
+        //Implementation:   alyr.cpp
+        std::string float_type_str();
+
+        //Name and size of the type used to store the exponents
+        //Implementation:   alyr.cpp
+        std::string storage_type_str();
+
         //Print errors and warnings
         //Implementation:   alyr.cpp
         void print_error(const std::string& msg);
@@ -56,31 +77,151 @@ namespace alyr{
         //Implementation: render.cpp
         std::vector<std::array<size_t, 4>> generate_sectors();
 
+        //Statistics of the exponents of all the pixels in a certain region
+        //Implementation: render.cpp
+        expstats_t block_exp_stats(const size_t& start_x, const size_t& start_y,
+                                   const size_t& end_x,   const size_t& end_y,
+                                   const lyap_exp_matrix_t& lyap_exp_matr);
+
+        //Move the clamps of the exponents to the required percentiles of their absolute values
+        //Implementation: render.cpp
+        void clamp_at_percentiles(const expstats_t& exp_stats, const long double& pos_percentile, const long double& neg_percentile,
+                                  long double& upper_pos_clamp, long double& lower_neg_clamp);
+
+        //Part of the render each pixel of the preview is sampled from, or preview_calculated for the pixels
+        //calculated before the render started (sectors completed before resuming it). Sets the size of the preview
+        //Implementation: preview.cpp
+        constexpr size_t preview_calculated = std::numeric_limits<size_t>::max();
+        std::vector<size_t> preview_pixel_parts(const std::vector<std::array<size_t, 4>>& parts, size_t& preview_width, size_t& preview_height);
+
+        //Write the downscaled preview of the exponents of the parts of the render completed so far, returns 0 on success
+        //Implementation: preview.cpp
+        int save_preview(const lyap_exp_matrix_t& lyap_exp_matr,
+                         const std::vector<size_t>& pixel_parts, const std::vector<std::atomic<bool>>& completed_parts,
+                         const size_t& preview_width, const size_t& preview_height,
+                         const std::string& filename);
+
         //Function to return a function pointer to a block renderer depending on the settings
         //Implementation:   alyr.cpp
         block_exp_calc_fn_ptr_t get_block_exp_calc_ptr();
 
-        //Lyapunov exponent calculator of all the pixels in a certain region
+        //Lyapunov exponent calculator of all the pixels in a certain region, iterated up to max_iter times.
+        //If orbits isn't null, the orbits continue from the states in it when extending a render (rsettings.extend_orbits)
+        //and their final states are stored in it
         //Implementation:   block_exp_calculator.ipp
-        template<map_fn_ptr_t map_fn, map_der_fn_ptr_t map_der_fn>
-        void block_exp_calculator(const size_t& img_width,  const size_t& img_height,
+        template<typename T, accumulation_mode acc_mode, map_fn_ptr_t<T> map_fn, map_der_fn_ptr_t<T> map_der_fn>
+        blockstats_t block_exp_calculator(const size_t& img_width,  const size_t& img_height,
                                   const size_t& start_x,    const size_t& start_y,
                                   const size_t& end_x,      const size_t& end_y,
-                                  std::vector<std::vector<long double>>& lyap_exp_matr);
-        //Renderer of a certain region
+                                  const size_t& max_iter,
+                                  lyap_exp_matrix_t& lyap_exp_matr,
+                                  orbit_matrix_t* orbits);
+        //Lyapunov exponent calculator of all the pixels in a certain region, specialized for a real x0
+        //and, if period != 0, for sequences of length period
+        //Implementation:   block_exp_calculator.ipp
+        template<typename T, accumulation_mode acc_mode, size_t period, real_map_fn_ptr_t<T> map_fn, real_map_der_fn_ptr_t<T> map_der_fn>
+        blockstats_t block_exp_calculator_real(const size_t& img_width,  const size_t& img_height,
+                                       const size_t& start_x,    const size_t& start_y,
+                                       const size_t& end_x,      const size_t& end_y,
+                                       const size_t& max_iter,
+                                       lyap_exp_matrix_t& lyap_exp_matr,
+                                       orbit_matrix_t* orbits);
+#if ALYR_SIMD_BYTES > 0
+        //Lyapunov exponent calculator of all the pixels in a certain region, vectorized for a real x0
+        //Implementation:   block_exp_calculator.ipp
+        template<typename T, accumulation_mode acc_mode, size_t period, real_map_fn_ptr_t<simd_vec<T>> map_fn, real_map_der_fn_ptr_t<simd_vec<T>> map_der_fn>
+        blockstats_t block_exp_calculator_simd(const size_t& img_width,  const size_t& img_height,
+                                       const size_t& start_x,    const size_t& start_y,
+                                       const size_t& end_x,      const size_t& end_y,
+                                       const size_t& max_iter,
+                                       lyap_exp_matrix_t& lyap_exp_matr,
+                                       orbit_matrix_t* orbits);
+#endif
+        //Coloring of the main image, as set by the current settings and palettes
+        //Implementation:   load_recolor_batch.cpp
+        recolor_variant_t current_recolor_variant();
+
+        //Build the lookup table of the colors of the exponents of a variant, given their statistics
+        //Implementation:   block_renderer.cpp
+        color_lut_t build_color_lut(const recolor_variant_t& variant, const expstats_t& exp_stats);
+
+        //Renderer of a certain region, in all the images at once (one lookup table per image)
+        //Implementation:   block_renderer.cpp
         void block_renderer(const size_t& start_x,      const size_t& start_y,
                             const size_t& end_x,        const size_t& end_y,
-                            const long double& max_pos, const long double& min_neg,
-                            std::vector<std::vector<long double>>& lyap_exp_matr,
-                            png::image<png::rgb_pixel>& img_to_color);
+                            const std::vector<color_lut_t>& luts,
+                            const lyap_exp_matrix_t& lyap_exp_matr,
+                            std::vector<png::image<png::rgb_pixel>>& imgs_to_color);
 
         //Save Lyapunov exponent matrix to file
         //Implementation:   save_load_lyap_exp_matr.cpp
-        int save_lyap_exp_matrix(const std::vector<std::vector<long double>>& matr, const std::string& filename);
+        int save_lyap_exp_matrix(const lyap_exp_matrix_t& matr, const std::string& filename);
+
+        //Save Lyapunov exponent matrix to a tiled and compressed file
+        //Implementation:   save_load_lyap_exp_matr.cpp
+        int save_compressed_lyap_exp_matrix(const lyap_exp_matrix_t& matr, const size_t& tile_size, const int& level,
+                                            std::vector<compressed_tile_t>& tiles, const std::string& filename);
 
-        //Load Lyapunov exponent matrix from file
+        //Compress a tile of the exponent matrix for save_compressed_lyap_exp_matrix
         //Implementation:   save_load_lyap_exp_matr.cpp
-        std::vector<std::vector<long double>> load_lyap_exp_matrix(const std::string& filename);
+        compressed_tile_t compress_lyap_exp_tile(const lyap_exp_matrix_t& matr,
+                                                 const size_t& start_x, const size_t& start_y,
+                                                 const size_t& end_x,   const size_t& end_y,
+                                                 const int& level);
+
+        //Number of tiles of side tile_size in a matrix
+        //Implementation:   save_load_lyap_exp_matr.cpp
+        size_t lyap_exp_tile_count(const size_t& num_rows, const size_t& num_cols, const size_t& tile_size);
+
+        //Check the saved exponent matrix file against its checksums, returns 0 if it's valid
+        //Implementation:   save_load_lyap_exp_matr.cpp
+        int verify_lyap_exp_matrix(const std::string& filename);
+
+        //Load Lyapunov exponent matrix from file, decompressing and checking it on the workers of pool
+        //Implementation:   save_load_lyap_exp_matr.cpp
+        lyap_exp_matrix_t load_lyap_exp_matrix(const std::string& filename, work_stealing_pool_t& pool);
+
+        //Create exponent matrix file and map it in memory, returns an empty matrix on failure
+        //Implementation:   save_load_lyap_exp_matr.cpp
+        lyap_exp_matrix_t create_mapped_lyap_exp_matrix(const size_t& num_rows, const size_t& num_cols,
+                                                        const storage_type& stype, const long double& scale,
+                                                        const std::string& filename);
+
+        //Map an existing exponent matrix file to resume its render, returns an empty matrix on failure
+        //Implementation:   save_load_lyap_exp_matr.cpp
+        lyap_exp_matrix_t open_mapped_lyap_exp_matrix(const size_t& num_rows, const size_t& num_cols,
+                                                      const storage_type& stype, const long double& scale,
+                                                      const std::string& filename);
+
+        //Settings of the current render, as saved in the exponent matrix files
+        //Implementation:   save_load_lyap_exp_matr.cpp
+        std::string render_settings_str();
+
+        //Write the checksums of a mapped exponent matrix and the whole file to the disk, returns 0 on success
+        //Implementation:   save_load_lyap_exp_matr.cpp
+        int sync_mapped_lyap_exp_matrix(lyap_exp_matrix_t& matr);
+
+        //Save the bitmap of the completed tiles of a render, returns 0 on success
+        //Implementation:   checkpoint.cpp
+        int save_checkpoint(const std::string& filename, const size_t& tile_size, const std::vector<bool>& completed_tiles);
+
+        //Load the bitmap of the completed tiles of a render, returns 0 on success
+        //Implementation:   checkpoint.cpp
+        int load_checkpoint(const std::string& filename, const size_t& tile_size, const size_t& num_tiles, std::vector<bool>& completed_tiles);
+
+        //Remove the checkpoint of a completed render
+        //Implementation:   checkpoint.cpp
+        void remove_checkpoint(const std::string& filename);
+
+        //Save the states of the orbits of all the pixels, returns 0 on success
+        //Implementation:   save_load_orbits.cpp
+        int save_orbit_states(const orbit_matrix_t& states, const std::string& filename);
+
+        //Load the states of the orbits saved by a render with the same settings and at most as many iterations,
+        //in a matrix allocated as alloc and filled by the workers of pool, sector by sector. Returns an empty matrix on failure
+        //Implementation:   save_load_orbits.cpp
+        orbit_matrix_t load_orbit_states(const std::string& filename, const matrix_alloc& alloc,
+                                         work_stealing_pool_t& pool, const std::vector<std::array<size_t, 4>>& sectors);
 
         //Compute color based on render data
         //Implementation:   block_renderer.cpp
@@ -0,0 +1,108 @@
+#ifndef COLOR_LUT_HPP_INCLUDED
+#define COLOR_LUT_HPP_INCLUDED
+
+#include "structs.hpp"
+
+#include <png++/png.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+//Coloring of one of the images produced from the exponent matrix: the image of the command line
+//or one of the variants of a batch recolor, each with its own palettes, coloring mode and clamps
+struct recolor_variant_t {
+    std::string image_name;
+    colorsettings_t csettings;
+
+    std::vector<png::rgb_pixel> npalette;
+    std::vector<png::rgb_pixel> ppalette;
+
+    long double lower_pos_clamp;
+    long double upper_pos_clamp;
+    long double lower_neg_clamp;
+    long double upper_neg_clamp;
+    long double pos_clamp_percentile;
+    long double neg_clamp_percentile;
+};
+
+//Lookup table of the colors of the exponents, built once per render from the palettes and the clamps.
+//The exponents are looked up as float: the finite exponents of each sign are clamped and turned into an index
+//of the colors of their sign; infinities, NaNs and every exponent in binary coloring take the color of their sign.
+//Linear tables have lut_size entries and are indexed by the clamped exponent, scaled.
+//Logarithmic tables are indexed by the bits of the absolute value of the clamped exponent: the exponent and the first
+//log_mantissa_bits bits of the mantissa of a float approximate its base 2 logarithm, so the table has 2^log_mantissa_bits
+//entries per octave, from log_min_abs up, and is indexed without computing any logarithm.
+//Every entry takes the color of the exponent at its center, so the colors can differ by 1 level per channel from
+//the ones blended for the exact exponent
+struct color_lut_t {
+    static constexpr size_t lut_size = 4096;
+    static constexpr int log_mantissa_bits = 6;
+    static constexpr int log_shift = std::numeric_limits<float>::digits - 1 - log_mantissa_bits;
+
+    //Colors of the finite exponents, if not in binary coloring
+    std::vector<png::rgb_pixel> pos_colors;
+    std::vector<png::rgb_pixel> neg_colors;
+    //Colors of the exponents not looked up in the tables
+    png::rgb_pixel pos_color;
+    png::rgb_pixel neg_color;
+
+    //Clamping intervals
+    float lower_pos_clamp;
+    float upper_pos_clamp;
+    float lower_neg_clamp;
+    float upper_neg_clamp;
+    //Factors and offsets scaling the clamped exponents to indexes of the linear tables
+    float pos_scale;
+    float pos_offset;
+    float neg_scale;
+    float neg_offset;
+    //Kind of the tables, and bits of the smallest absolute value of the logarithmic tables
+    bool logarithmic;
+    uint32_t log_min_bits;
+
+    //Bits of the absolute value of a float
+    static uint32_t abs_bits(const float& value){
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits & 0x7fffffff;
+    }
+
+    //Float whose bits are the given ones
+    static float from_bits(const uint32_t& bits){
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    //Number of entries of a logarithmic table with absolute values from min_abs to max_abs
+    static size_t log_lut_size(const float& min_abs, const float& max_abs){
+        return ((abs_bits(max_abs) - abs_bits(min_abs)) >> log_shift) + 1;
+    }
+
+    //Color of an exponent
+    png::rgb_pixel color(const float& lyap_exp) const {
+        if(!std::isfinite(lyap_exp) || pos_colors.empty())
+            return (lyap_exp >= 0) ? pos_color : neg_color;
+
+        if(lyap_exp >= 0)
+            return pos_colors[index(std::clamp(lyap_exp, lower_pos_clamp, upper_pos_clamp), pos_scale, pos_offset, pos_colors.size())];
+        else
+            return neg_colors[index(std::clamp(lyap_exp, lower_neg_clamp, upper_neg_clamp), neg_scale, neg_offset, neg_colors.size())];
+    }
+
+private:
+    size_t index(const float& clamped_exp, const float& scale, const float& offset, const size_t& size) const {
+        if(logarithmic){
+            const uint32_t bits = abs_bits(clamped_exp);
+            return (bits <= log_min_bits) ? 0 : std::min<size_t>((bits - log_min_bits) >> log_shift, size - 1);
+        }
+        return static_cast<size_t>(std::clamp(clamped_exp * scale + offset, 0.0f, static_cast<float>(size - 1)));
+    }
+};
+
+#endif
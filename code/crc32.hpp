@@ -0,0 +1,22 @@
+#ifndef CRC32_HPP_INCLUDED
+#define CRC32_HPP_INCLUDED
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <zlib.h>
+
+//CRC-32 of size bytes, continuing from crc (0 for the first bytes).
+//zlib takes the size as an unsigned int, so longer buffers are passed in blocks
+inline uint32_t crc32_bytes(uLong crc, const unsigned char* data, size_t size){
+    while(size > 0){
+        const uInt block = static_cast<uInt>(std::min<size_t>(size, UINT_MAX));
+        crc = crc32(crc, data, block);
+        data += block;
+        size -= block;
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef FLOAT_TYPES_HPP_INCLUDED
+#define FLOAT_TYPES_HPP_INCLUDED
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#ifdef ALYR_FLOAT128
+#include <quadmath.h>
+#endif
+
+//Small wrappers around the maths functions used by the kernels, so that the same code
+//can be instantiated both for the standard floating point types and for __float128,
+//which is not supported by <cmath>
+template<typename T>
+inline T fp_log(const T& x){
+    return std::log(x);
+}
+
+template<typename T>
+inline T fp_abs(const T& x){
+    return std::abs(x);
+}
+
+template<typename T>
+inline bool fp_isfinite(const T& x){
+    return std::isfinite(x);
+}
+
+template<typename T>
+inline T fp_infinity(){
+    return std::numeric_limits<T>::infinity();
+}
+
+//Split x in m * 2^e, with m in [0.5, 1)
+template<typename T>
+inline T fp_frexp(const T& x, int& e){
+    return std::frexp(x, &e);
+}
+
+//2^(max_exponent/2): a value in [1/bound, bound] can be multiplied by any other value in the
+//same range without overflowing or underflowing
+template<typename T>
+inline T fp_half_range_bound(){
+    return std::ldexp(T{1}, std::numeric_limits<T>::max_exponent / 2);
+}
+
+//Linear interpolation between a and b
+template<typename T>
+inline T fp_lerp(const T& a, const T& b, const T& t){
+    return std::lerp(a, b, t);
+}
+
+#ifdef ALYR_FLOAT128
+using float128_t = __float128;
+
+template<>
+inline float128_t fp_log(const float128_t& x){
+    return logq(x);
+}
+
+template<>
+inline float128_t fp_abs(const float128_t& x){
+    return fabsq(x);
+}
+
+template<>
+inline bool fp_isfinite(const float128_t& x){
+    return finiteq(x);
+}
+
+template<>
+inline float128_t fp_infinity(){
+    return __builtin_huge_valq();
+}
+
+template<>
+inline float128_t fp_frexp(const float128_t& x, int& e){
+    return frexpq(x, &e);
+}
+
+template<>
+inline float128_t fp_half_range_bound(){
+    return ldexpq(1, FLT128_MAX_EXP / 2);
+}
+
+template<>
+inline float128_t fp_lerp(const float128_t& a, const float128_t& b, const float128_t& t){
+    return (t == 1) ? b : a + t * (b - a);
+}
+#endif
+
+#endif
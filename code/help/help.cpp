@@ -15,6 +15,18 @@ Disclaimer: program is still a work in progress, might be buggy, some features h
         --verbose
                     Print miscellaneous information on the current render during the execution.
                     This option is recommended but not on by default.
+                    While calculating and coloring the exponents, prints the completed sectors,
+                    the pixels and iterations per second, the estimated time left and the
+                    average and minimum utilization of the threads.
+
+        -pj <FILENAME>
+        --progress-json <FILENAME>
+                    While calculating and coloring the exponents, appends the progress of the
+                    render to <FILENAME> once per second as JSON lines, one object per line with
+                    the fields "phase" ("exp" or "color"), "elapsed_s", "sectors", "total_sectors",
+                    "pixels", "total_pixels", "iterations", "pixels_per_s", "iterations_per_s",
+                    "eta_s" (null while unknown), "utilization" (one value in [0, 1] per thread)
+                    and "done" (true on the last line of each phase).
 
     Image related flags
         -w <SIZE_T>
@@ -35,6 +47,9 @@ Disclaimer: program is still a work in progress, might be buggy, some features h
         --save-matrix <STRING>
                     Saves the matrix of the calculated Lyapunov exponents to a file
                     whose name is "<STRING>.expbin".
+                    The file also contains the settings of the render and the checksums
+                    of the exponents, which are used to check the file after saving it
+                    and when loading it.
 
         -lm <STRING>
         --load <STRING>
@@ -43,7 +58,79 @@ Disclaimer: program is still a work in progress, might be buggy, some features h
                     whose name is "<STRING.expbin>".
                     If this flag is specified, no calculations are performed and the
                     matrix is directly loaded.
-                    This overwrites the image size with the size of the loaded matrix.
+                    This overwrites the image size with the size of the loaded matrix, and
+                    the map, sequence, limits and iteration settings with the ones saved
+                    in the file (files saved by older versions don't contain them).
+                    The header and the settings are always checked against their checksum.
+                    Uncompressed files are mapped in memory, and their exponents are checked
+                    against their checksums only with --verify-matrix, so that recoloring a
+                    big matrix doesn't read the whole file an extra time; compressed files, and
+                    files that can't be mapped, are always checked.
+
+        -vm
+        --verify-matrix
+                    Used together with --load, checks all the exponents of a mapped exponent
+                    matrix file against their checksums (in parallel) before using them.
+
+        -mm
+        --mmap
+                    Used together with --save, creates the exponent matrix file before the
+                    render and maps it in memory: the exponents are calculated directly into
+                    the file, without keeping a copy of the matrix in RAM and without a
+                    separate saving step. Only available on systems supporting mmap.
+
+        -z <INT>
+        --compress <INT>
+                    Used together with --save, saves the exponent matrix file divided into
+                    tiles as big as the sectors, each one compressed with deflate at the
+                    level <INT> (1 = fastest, 9 = smallest) by the thread that calculated it.
+                    Areas of uniform or smooth exponents compress very well.
+                    Compressed files can't be mapped in memory, neither when saving (--mmap)
+                    nor when loading them.
+                    The default value is 0 (no compression).
+
+        -ck <SIZE_T>
+        --checkpoint <SIZE_T>
+                    Used together with --save, every <SIZE_T> seconds writes the exponents
+                    calculated so far to the exponent matrix file and records which sectors
+                    are completed in a checkpoint file next to it (<FILENAME>.expbin.ckpt).
+                    The exponent matrix file is mapped in memory (see --mmap) and can't be
+                    compressed. The checkpoint file is removed once the render is complete.
+                    The default value is 0 (no checkpoints).
+
+        -pv <SIZE_T>
+        --preview <SIZE_T>
+                    Every <SIZE_T> seconds while calculating the exponents, writes a preview of the
+                    image to "<NAME>_preview.png", where <NAME> is the name of the output image.
+                    The preview is downscaled to at most 512 pixels per side and colored like the
+                    image (with the statistics of the exponents in the preview), and the pixels
+                    not calculated yet are black.
+                    The default value is 0 (no previews).
+
+        -rs
+        --resume
+                    Resumes an interrupted render from the file specified with --save and its
+                    checkpoint file, calculating only the sectors not completed yet.
+                    All the other settings must be the same as those of the interrupted
+                    render; the result is identical to an uninterrupted render.
+
+        -so
+        --save-orbits
+                    Used together with --save, also saves the final state of the orbit of
+                    every pixel (last element, sum of the logarithms of the derivatives and
+                    number of iterations) to <FILENAME>.orbits, so that the render can later
+                    be extended to more iterations with --extend. Takes 64 bytes per pixel.
+
+        -xo <FILENAME>
+        --extend <FILENAME>
+                    Continues the orbits saved with --save-orbits in <FILENAME>.orbits up to
+                    the number of iterations of this render, performing only the extra ones.
+                    All the other settings must be the same as those of the saved render.
+                    The result is identical to a render performed from the start, except for
+                    small rounding differences when the exponents are accumulated as products
+                    or the float type is float128 (the states are saved as long double), and
+                    when cycle or convergence detection are enabled (they start over from the
+                    saved states).
 
         --skip
         --skip-coloring
@@ -57,6 +144,27 @@ Disclaimer: program is still a work in progress, might be buggy, some features h
                     This flag allows setting the maximum length of the side of these sectors.
                     The default value is 64.
 
+        -fs
+        --fixed-sectors
+                    Disables the adaptive subdivision of the sectors. By default, before calculating
+                    the exponents, their cost is estimated on a probe with 1/64 of the pixels and 1/8
+                    of the iterations after the transient, and the heaviest sectors are split into
+                    strips of rows, so that the threads don't wait for a few slow sectors at the end
+                    of the render. The exponents don't depend on the subdivision.
+
+        -sor <STRING>
+        --sector-order <STRING>
+                    Sets the order in which the sectors are calculated and colored.
+                    Every thread takes a contiguous run of sectors in this order.
+                    The supported orders are:
+                    row             -> row by row, from the top left corner.
+                    morton          -> along a Morton (Z-order) curve.
+                    hilbert         -> along a Hilbert curve, every thread works on a compact
+                                       region of the image, with better cache and page locality.
+                    center          -> from the center of the image outwards, every thread
+                                       starting from the center (useful with --preview).
+                    The default value is "hilbert".
+
         -T <SIZE_T>
         --max-threads <SIZE_T>
                     Maximum number of threads utilized to render the fractal.
@@ -64,6 +172,70 @@ Disclaimer: program is still a work in progress, might be buggy, some features h
                     core that the machine has.
                     If this detection fails, only 1 rendering thread is used.
 
+        -pin
+        --pin-threads
+                    Pins every rendering thread to its own core, taking the cores the program
+                    is allowed to run on in order (e.g. the ones selected with taskset or
+                    numactl). The pages of the exponent matrix are always placed in the memory
+                    of the thread that writes them first, which is the thread calculating their
+                    sectors, so pinned threads keep their sectors in the memory of their own
+                    NUMA node. Only available on Linux.
+
+        -hp
+        --huge-pages
+                    Allocates the exponent matrix (and the orbit states) in huge pages, reducing
+                    the TLB misses of big renders. Uses the huge pages reserved in the system
+                    (see /proc/sys/vm/nr_hugepages) if there are enough, or else transparent
+                    huge pages. Not available for exponent matrices mapped to a file (--mmap,
+                    --checkpoint).
+
+        -ft <STRING>
+        --float-type <STRING>
+                    Sets the floating point type used to iterate the map.
+                    The supported types are:
+                    float           -> single precision
+                    double          -> double precision
+                    longdouble      -> extended precision (also "long-double")
+                    float128        -> quadruple precision, only if compiled with __float128
+                                       support and only for a real x0 (also "__float128")
+                    Narrower types are considerably faster, the wider ones are only needed
+                    for deep zooms.
+                    The default value is "longdouble".
+
+        -ea <STRING>
+        --exp-accumulation <STRING>
+                    Sets how the logarithms of the derivatives are summed into the exponent.
+                    The supported modes are:
+                    log             -> one logarithm per iteration.
+                    product         -> the derivatives are multiplied into a running product,
+                                       whose binary exponent is pulled out whenever it gets close
+                                       to over/underflowing, and only one logarithm per pixel is
+                                       taken at the end. Much faster. The finite exponents differ
+                                       from the "log" mode by at most about
+                                       (iterations) x (epsilon of the float type) x |exponent|,
+                                       which is the rounding error of the sum of the logarithms.
+                    The default value is "log".
+
+        -st <STRING>
+        --storage-type <STRING>
+                    Sets the type used to store the exponents in RAM and in the saved exponent
+                    matrix files. The exponents are always calculated with the floating point
+                    type set by --float-type and rounded only when stored.
+                    The supported types are:
+                    longdouble      -> extended precision (also "long-double")
+                    float           -> single precision, 4 bytes per pixel
+                    half            -> IEEE half precision, 2 bytes per pixel, ~3 significant
+                                       digits, exponents beyond +-65504 become infinities
+                    int16           -> 16 bit integer multiple of the scale set by --storage-scale,
+                                       2 bytes per pixel, finite exponents beyond +-32766 x scale
+                                       are saturated. nan and infinities are preserved
+                    The default value is "longdouble".
+
+        -ss <LONG DOUBLE>
+        --storage-scale <LONG DOUBLE>
+                    Sets the quantization step of the "int16" storage type.
+                    The default value is 1/2048 (exponents in about [-16, 16]).
+
     Fractal related flags
         -m <STRING>
         --map <STRING>
@@ -137,6 +309,39 @@ Disclaimer: program is still a work in progress, might be buggy, some features h
                     Sets the maximum number of initial iterations to ignore in the calculation of
                     the Lyapunov exponent. This is to remove the transient behaviour.
                     The default value is 200.
+        -cd <DOUBLE>
+        --cycle-detection <DOUBLE>
+                    Enables the early exit from the iterations for orbits that can be classified,
+                    when x0 is real:
+                    - orbits going past |x| > 1e10 are divergent, their exponent is set to +inf;
+                    - orbits that, sampled at the end of every repetition of the sequence, come back
+                      within <DOUBLE> of an earlier sample (Brent's cycle detection) are periodic,
+                      their exponent is the average over one cycle.
+                    Stable regions usually settle into a short cycle within a few hundred iterations,
+                    so with a high number of iterations this saves most of their cost.
+                    Exponents of periodic orbits differ slightly from the ones averaged over all the
+                    iterations, which still contain the approach to the cycle.
+                    A tolerance of 0 disables this feature. Sensible values are around 1e-10 for
+                    double or long double and 1e-5 for float.
+                    With a complex x0 this feature isn't available, and it's disabled with a warning.
+                    The default value is 0.
+        -ct <DOUBLE>
+        --convergence-tol <DOUBLE>
+                    Enables the adaptive number of iterations per pixel, when x0 is real: every
+                    <SIZE_T> iterations (see --convergence-interval) the running estimate of the
+                    exponent is compared with the one of the previous check, and the pixel stops
+                    iterating once they differ by less than <DOUBLE>.
+                    The maximum number of iterations still acts as a hard cap.
+                    The minimum, average and maximum number of iterations per pixel are printed
+                    with the verbose output.
+                    A tolerance of 0 disables this feature.
+                    With a complex x0 this feature isn't available, and it's disabled with a warning.
+                    The default value is 0.
+        -ci <SIZE_T>
+        --convergence-interval <SIZE_T>
+                    Sets the number of iterations between two convergence checks. It gets rounded
+                    up to a multiple of the length of the sequence.
+                    The default value is 100.
 
         NOTE:
         The next set of flags specifies the minima and the maxima of the positive and negative (finite) exponents.
@@ -159,6 +364,18 @@ Disclaimer: program is still a work in progress, might be buggy, some features h
         --upp-neg-clamp <DOUBLE>
                     Sets the upper clamping value for negative exponents.
                     The default value is 0.
+        -ppc <DOUBLE>
+        --pos-clamp-percentile <DOUBLE>
+                    Lowers the upper clamping value for positive exponents to the given
+                    percentile (in (0, 100]) of the positive exponents, estimated from a
+                    histogram with 32 logarithmic bins per decade. For example 99.5 keeps
+                    the few highest exponents from compressing the colors of all the others.
+                    The default value is 100 (no clamping).
+        -npc <DOUBLE>
+        --neg-clamp-percentile <DOUBLE>
+                    Raises the lower clamping value for negative exponents to the given
+                    percentile (in (0, 100]) of the absolute values of the negative exponents.
+                    The default value is 100 (no clamping).
 
     Color related flags
         -np <STRING>
@@ -197,10 +414,30 @@ Disclaimer: program is still a work in progress, might be buggy, some features h
                                        is chosen, otherwise the last color from the positive palette is chosen.
                     linear          -> maps the palettes to the maxima and minima of the positive and negative
                                        exponents and performs linear interpolation between colors.
+                    histeq          -> like linear, but maps the palettes to the distribution of the absolute
+                                       values of the exponents (histogram equalization), so that every color
+                                       is taken by about as many pixels, even when a few extreme exponents
+                                       stretch their range. The distribution is estimated from histograms with
+                                       32 logarithmic bins per decade, between 1e-12 and 1e4.
+                    The colors of linear and histeq coloring are computed once per render, in tables of
+                    a few thousand entries, and looked up for every pixel: they can differ by 1 level per
+                    channel from the color blended for the exact exponent.
                     The default value is "linear"
 
         -C
         --crosshair
                     Draws a crosshair in the middle of the image.
+
+        -br <FILENAME>
+        --batch-recolor <FILENAME>
+                    Colors, in addition to the main image, one image for every line of <FILENAME>,
+                    from the same exponent matrix and in the same pass over it. Each line contains
+                    the -o option, with the name of its image, and any of the coloring options
+                    (-np, -pp, -c, -C and the clamping options), which otherwise are taken from
+                    the command line. Empty lines and lines starting with '#' are skipped.
+                    For example, with -lm to load a matrix:
+                    -o fractal_fire -pp fire_palette -ppc 99
+                    -o fractal_binary -c binary
+                    All the images are kept in RAM until the coloring is completed.
 )foo";
 }
\ No newline at end of file
@@ -0,0 +1,288 @@
+#ifndef LYAP_EXP_MATRIX_HPP_INCLUDED
+#define LYAP_EXP_MATRIX_HPP_INCLUDED
+
+#include "structs.hpp"
+#include "matrix.hpp"
+#include "mapped_file.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+//Bytes of a long double holding its value: the x87 extended format (64 bit mantissa) uses 10 of them,
+//the others are padding whose content is indeterminate
+constexpr size_t long_double_value_size = (std::numeric_limits<long double>::digits == 64) ? 10 : sizeof(long double);
+
+//Store a long double in sizeof(long double) bytes with its padding bytes zeroed,
+//so that equal values are always stored as equal bytes (and files with them are reproducible)
+inline void store_long_double(unsigned char* p, const long double& value){
+    std::memset(p, 0, sizeof(long double));
+    std::memcpy(p, &value, long_double_value_size);
+}
+
+//Conversion between float and IEEE 754 binary16 (half precision), rounding to nearest even
+inline uint16_t float_to_half(const float& f){
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+
+    const uint16_t sign = (x >> 16) & 0x8000;
+    const uint32_t absx = x & 0x7fffffff;
+
+    //Infinities and nan
+    if(absx >= 0x7f800000)
+        return sign | 0x7c00 | ((absx > 0x7f800000) ? 0x200 : 0);
+    //Too big, rounds to infinity
+    if(absx >= 0x477ff000)
+        return sign | 0x7c00;
+    //Too small, rounds to zero
+    if(absx < 0x33000000)
+        return sign;
+
+    uint32_t mant  = absx & 0x7fffff;
+    uint32_t shift = 13;
+    uint32_t code;
+    if(absx < 0x38800000){
+        //Subnormal half
+        mant |= 0x800000;
+        shift = 126 - (absx >> 23);
+        code  = mant >> shift;
+    }
+    else
+        code = ((((absx >> 23) - 127 + 15) << 10) | (mant >> 13));
+
+    const uint32_t rem  = mant & ((1u << shift) - 1);
+    const uint32_t half = 1u << (shift - 1);
+    if(rem > half || (rem == half && (code & 1)))
+        ++code;
+
+    return sign | static_cast<uint16_t>(code);
+}
+
+inline float half_to_float(const uint16_t& h){
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    const uint32_t e    = (h >> 10) & 0x1f;
+    const uint32_t m    = h & 0x3ff;
+
+    uint32_t x;
+    if(e == 0x1f)
+        x = sign | 0x7f800000 | (m << 13);
+    else if(e == 0){
+        //Zero or subnormal half, m * 2^-24
+        const float v = std::ldexp(static_cast<float>(m), -24);
+        return sign ? -v : v;
+    }
+    else
+        x = sign | ((e - 15 + 127) << 23) | (m << 13);
+
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+//Matrix of the Lyapunov exponents.
+//The exponents can be stored with one of the types in storage_type, to reduce the memory needed by big renders:
+//they're always read and written as long double, and rounded to the storage type when written.
+//storage_type::int16 stores round(exponent / scale), saturating to the largest finite code; some codes are
+//reserved for nan and infinities. The scale is rounded to double, as it's saved in the files.
+//The exponents are either allocated in RAM or stored in a file mapped in memory
+class lyap_exp_matrix_t {
+public:
+    static constexpr int16_t qint16_nan     = std::numeric_limits<int16_t>::min();
+    static constexpr int16_t qint16_neg_inf = std::numeric_limits<int16_t>::min() + 1;
+    static constexpr int16_t qint16_pos_inf = std::numeric_limits<int16_t>::max();
+    static constexpr int16_t qint16_max     = std::numeric_limits<int16_t>::max() - 1;
+
+    //Default quantization step of storage_type::int16, exponents in [-16, 16] with steps of ~5e-4
+    static constexpr long double default_qint16_scale = 1.0l / 2048;
+
+    lyap_exp_matrix_t() :
+        stype(storage_type::long_double), elem_size(sizeof(long double)),
+        num_rows(0), num_cols(0), row_pitch(0), qscale(default_qint16_scale),
+        base(nullptr), bytes(), mapping() {}
+
+    //Matrix allocated in RAM, filled with zero bytes
+    lyap_exp_matrix_t(const size_t& rows, const size_t& cols,
+                      const storage_type& type = storage_type::long_double,
+                      const long double& qint16_scale = default_qint16_scale,
+                      const matrix_alloc& alloc = matrix_alloc::filled) :
+        stype(type),
+        elem_size(element_size(type)),
+        num_rows(rows),
+        num_cols(cols),
+        row_pitch(0),
+        qscale(static_cast<double>(qint16_scale)),
+        base(nullptr),
+        bytes(rows, cols * element_size(type), alloc),
+        mapping()
+    {
+        base = bytes.data();
+        row_pitch = bytes.stride();
+    }
+
+    //Matrix stored in a mapped file, starting offset bytes after the beginning of the mapping,
+    //with the rows one after the other without padding
+    lyap_exp_matrix_t(mapped_file_t&& file, const size_t& offset,
+                      const size_t& rows, const size_t& cols,
+                      const storage_type& type = storage_type::long_double,
+                      const long double& qint16_scale = default_qint16_scale) :
+        stype(type),
+        elem_size(element_size(type)),
+        num_rows(rows),
+        num_cols(cols),
+        row_pitch(cols * element_size(type)),
+        qscale(static_cast<double>(qint16_scale)),
+        base(nullptr),
+        bytes(),
+        mapping(std::make_shared<mapped_file_t>(std::move(file)))
+    {
+        base = mapping->data() + offset;
+    }
+
+    lyap_exp_matrix_t(lyap_exp_matrix_t&&) = default;
+    lyap_exp_matrix_t& operator=(lyap_exp_matrix_t&&) = default;
+
+    //Copies of a matrix in RAM are allocated in RAM, copies of a mapped matrix share the same mapping
+    lyap_exp_matrix_t(const lyap_exp_matrix_t& other) :
+        stype(other.stype),
+        elem_size(other.elem_size),
+        num_rows(other.num_rows),
+        num_cols(other.num_cols),
+        row_pitch(other.row_pitch),
+        qscale(other.qscale),
+        base(other.base),
+        bytes(other.bytes),
+        mapping(other.mapping)
+    {
+        if(!mapping)
+            base = bytes.data();
+    }
+    lyap_exp_matrix_t& operator=(const lyap_exp_matrix_t& other){
+        if(this != &other)
+            *this = lyap_exp_matrix_t(other);
+        return *this;
+    }
+
+    size_t rows()  const {return num_rows;}
+    size_t cols()  const {return num_cols;}
+    bool   empty() const {return num_rows == 0 || num_cols == 0;}
+
+    storage_type type()  const {return stype;}
+    size_t elem_bytes()  const {return elem_size;}
+    long double scale()  const {return qscale;}
+
+    //True if the exponents are stored in a mapped file
+    bool is_mapped() const {return static_cast<bool>(mapping);}
+    //True if the exponents are allocated in RAM backed by huge pages
+    bool huge_pages() const {return !mapping && bytes.huge_pages();}
+    //Mapped file containing the exponents, nullptr if the matrix is allocated in RAM
+    mapped_file_t* mapped_file() {return mapping.get();}
+
+    //Raw storage of a row, cols() * elem_bytes() bytes
+    unsigned char*       row_bytes(const size_t& y)       {return base + y * row_pitch;}
+    const unsigned char* row_bytes(const size_t& y) const {return base + y * row_pitch;}
+
+    //Read the exponent in (x, y)
+    long double get(const size_t& y, const size_t& x) const {
+        const unsigned char* p = row_bytes(y) + x * elem_size;
+        switch(stype){
+            case storage_type::float32:
+            {   float v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+            case storage_type::float16:
+            {   uint16_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return half_to_float(v);
+            }
+            case storage_type::int16:
+            {   int16_t v;
+                std::memcpy(&v, p, sizeof(v));
+                switch(v){
+                    case qint16_nan:        return std::numeric_limits<long double>::quiet_NaN();
+                    case qint16_neg_inf:    return -std::numeric_limits<long double>::infinity();
+                    case qint16_pos_inf:    return std::numeric_limits<long double>::infinity();
+                    default:                return static_cast<long double>(v) * qscale;
+                }
+            }
+            default:
+            case storage_type::long_double:
+            {   long double v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+        }
+    }
+
+    //Write the exponent in (x, y), rounding it to the storage type
+    void set(const size_t& y, const size_t& x, const long double& value){
+        unsigned char* p = row_bytes(y) + x * elem_size;
+        switch(stype){
+            case storage_type::float32:
+            {   const float v = static_cast<float>(value);
+                std::memcpy(p, &v, sizeof(v));
+            }   break;
+            case storage_type::float16:
+            {   const uint16_t v = float_to_half(static_cast<float>(value));
+                std::memcpy(p, &v, sizeof(v));
+            }   break;
+            case storage_type::int16:
+            {   int16_t v;
+                if(std::isnan(value))
+                    v = qint16_nan;
+                else if(std::isinf(value))
+                    v = (value > 0) ? qint16_pos_inf : qint16_neg_inf;
+                else
+                    v = static_cast<int16_t>(std::clamp<long double>(std::round(value / qscale), -qint16_max, qint16_max));
+                std::memcpy(p, &v, sizeof(v));
+            }   break;
+            default:
+            case storage_type::long_double:
+                store_long_double(p, value);
+                break;
+        }
+    }
+
+    //Two matrices are equal if they have the same size, storage and elements
+    //(elements are compared by value, the padding bytes of long double are ignored)
+    bool operator==(const lyap_exp_matrix_t& other) const {
+        if(stype != other.stype || qscale != other.qscale || rows() != other.rows() || cols() != other.cols())
+            return false;
+
+        for(size_t y = 0; y < rows(); ++y)
+            for(size_t x = 0; x < cols(); ++x)
+                if(get(y, x) != other.get(y, x))
+                    return false;
+
+        return true;
+    }
+
+    //Size in bytes of an element stored with a certain type, 0 if unknown
+    static size_t element_size(const storage_type& type){
+        switch(type){
+            case storage_type::long_double: return sizeof(long double);
+            case storage_type::float32:     return sizeof(float);
+            case storage_type::float16:     return sizeof(uint16_t);
+            case storage_type::int16:       return sizeof(int16_t);
+            default:                        return 0;
+        }
+    }
+
+private:
+    storage_type stype;
+    size_t elem_size;
+    size_t num_rows;
+    size_t num_cols;
+    //Distance in bytes between two rows
+    size_t row_pitch;
+    long double qscale;
+
+    //First row, either in bytes or in mapping
+    unsigned char* base;
+    matrix_t<unsigned char> bytes;
+    std::shared_ptr<mapped_file_t> mapping;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef MAPPED_FILE_HPP_INCLUDED
+#define MAPPED_FILE_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #define ALYR_MMAP 1
+#else
+    #define ALYR_MMAP 0
+#endif
+
+//File mapped in memory with mmap, unmapped when the object is destroyed.
+//The changes made to a file mapped for writing reach the file through the page cache,
+//sync() waits until they're written to the disk.
+//On platforms without mmap, every attempt to map a file fails
+class mapped_file_t {
+public:
+    mapped_file_t() : ptr(nullptr), len(0) {}
+    ~mapped_file_t(){unmap();}
+
+    mapped_file_t(const mapped_file_t&) = delete;
+    mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+    mapped_file_t(mapped_file_t&& other) : ptr(std::exchange(other.ptr, nullptr)), len(std::exchange(other.len, 0)) {}
+    mapped_file_t& operator=(mapped_file_t&& other){
+        if(this != &other){
+            unmap();
+            ptr = std::exchange(other.ptr, nullptr);
+            len = std::exchange(other.len, 0);
+        }
+        return *this;
+    }
+
+    unsigned char*       data()       {return ptr;}
+    const unsigned char* data() const {return ptr;}
+    size_t size()      const {return len;}
+    bool   is_mapped() const {return ptr != nullptr;}
+
+    //Create (or truncate) a file of size bytes and map it for reading and writing.
+    //The space on disk is reserved in advance, so that running out of it is reported here
+    //and not as a SIGBUS while writing to the mapping.
+    //Returns 0 on success
+    int create(const std::string& filename, const size_t& size){
+        unmap();
+#if ALYR_MMAP
+        if(size == 0)
+            return 1;
+
+        const int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0)
+            return 1;
+
+        //Filesystems that don't support fallocate can still grow the file with ftruncate
+        const int alloc_err = ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+        if(alloc_err != 0 && ((alloc_err != EINVAL && alloc_err != EOPNOTSUPP) || ::ftruncate(fd, static_cast<off_t>(size)) != 0)){
+            ::close(fd);
+            return 1;
+        }
+
+        return map_fd(fd, size, PROT_READ | PROT_WRITE);
+#else
+        (void)filename;
+        (void)size;
+        return 1;
+#endif
+    }
+
+    //Map an existing file for reading only.
+    //Where supported, the page tables are filled in advance, so that reading a file that is already
+    //in the page cache doesn't cost a page fault for every page.
+    //Returns 0 on success
+    int open_read(const std::string& filename){
+        unmap();
+#if ALYR_MMAP
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if(fd < 0)
+            return 1;
+
+        struct stat file_stat;
+        if(::fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0){
+            ::close(fd);
+            return 1;
+        }
+
+#ifdef MAP_POPULATE
+        return map_fd(fd, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_POPULATE);
+#else
+        return map_fd(fd, static_cast<size_t>(file_stat.st_size), PROT_READ);
+#endif
+#else
+        (void)filename;
+        return 1;
+#endif
+    }
+
+    //Map an existing file for reading and writing.
+    //Returns 0 on success
+    int open_write(const std::string& filename){
+        unmap();
+#if ALYR_MMAP
+        const int fd = ::open(filename.c_str(), O_RDWR);
+        if(fd < 0)
+            return 1;
+
+        struct stat file_stat;
+        if(::fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0){
+            ::close(fd);
+            return 1;
+        }
+
+        return map_fd(fd, static_cast<size_t>(file_stat.st_size), PROT_READ | PROT_WRITE);
+#else
+        (void)filename;
+        return 1;
+#endif
+    }
+
+    //Write the changes to the disk.
+    //Returns 0 on success
+    int sync(){
+#if ALYR_MMAP
+        return (ptr != nullptr && ::msync(ptr, len, MS_SYNC) == 0) ? 0 : 1;
+#else
+        return 1;
+#endif
+    }
+
+private:
+#if ALYR_MMAP
+    //Map the file and close its descriptor, the mapping stays valid
+    int map_fd(const int& fd, const size_t& size, const int& prot, const int& flags = 0){
+        void* p = ::mmap(nullptr, size, prot, MAP_SHARED | flags, fd, 0);
+        ::close(fd);
+
+        if(p == MAP_FAILED)
+            return 1;
+
+        ptr = static_cast<unsigned char*>(p);
+        len = size;
+        return 0;
+    }
+#endif
+
+    void unmap(){
+#if ALYR_MMAP
+        if(ptr != nullptr)
+            ::munmap(ptr, len);
+#endif
+        ptr = nullptr;
+        len = 0;
+    }
+
+    unsigned char* ptr;
+    size_t len;
+};
+
+#endif
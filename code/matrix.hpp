@@ -0,0 +1,172 @@
+#ifndef MATRIX_HPP_INCLUDED
+#define MATRIX_HPP_INCLUDED
+
+#include "mapped_file.hpp"
+
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+
+//How the buffer of a matrix is allocated
+enum class matrix_alloc {
+    //Allocated and filled by the thread constructing the matrix, so all its pages are placed on the NUMA node of that thread
+    filled,
+    //Zeroed pages mapped on demand: every page is placed on the NUMA node of the thread writing to it first
+    first_touch,
+    //Like first_touch, backed by the huge pages reserved in the system (MAP_HUGETLB) if there are enough,
+    //or else by transparent huge pages where supported
+    huge_pages
+};
+
+//Two-dimensional matrix stored in a single contiguous buffer, row by row.
+//Every row starts at an address aligned to matrix_t::alignment bytes, so that rows can be
+//processed with aligned vector loads/stores; the distance between two rows is stride() elements.
+//Elements are accessed as matr[y][x]
+template<typename T>
+class matrix_t {
+public:
+    static constexpr size_t alignment = 64;
+
+    matrix_t() : num_rows(0), num_cols(0), row_stride(0), buffer(nullptr) {}
+
+    matrix_t(const size_t& rows, const size_t& cols, const T& value = T{}) :
+        num_rows(rows),
+        num_cols(cols),
+        row_stride(padded_stride(cols)),
+        buffer(allocate(rows * row_stride))
+    {
+        std::fill_n(buffer.get(), rows * row_stride, value);
+    }
+
+    //Matrix of zero bytes, allocated as required (matrix_alloc::filled where memory can't be mapped).
+    //The pages of the other allocations are touched only when written, so the threads that will write
+    //the rows must be the first ones to touch them
+    matrix_t(const size_t& rows, const size_t& cols, const matrix_alloc& alloc) :
+        num_rows(rows),
+        num_cols(cols),
+        row_stride(padded_stride(cols)),
+        buffer(nullptr)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "matrices of zero bytes require trivially copyable elements");
+
+        if(alloc == matrix_alloc::filled || !map_anonymous(rows * row_stride * sizeof(T), alloc == matrix_alloc::huge_pages)){
+            buffer.reset(allocate(rows * row_stride));
+            std::fill_n(reinterpret_cast<unsigned char*>(buffer.get()), rows * row_stride * sizeof(T), 0);
+        }
+    }
+
+    matrix_t(matrix_t&&) = default;
+    matrix_t& operator=(matrix_t&&) = default;
+
+    matrix_t(const matrix_t& other) : matrix_t(other.num_rows, other.num_cols) {
+        std::copy_n(other.buffer.get(), num_rows * row_stride, buffer.get());
+    }
+    matrix_t& operator=(const matrix_t& other){
+        if(this != &other)
+            *this = matrix_t(other);
+        return *this;
+    }
+
+    size_t rows()   const {return num_rows;}
+    size_t cols()   const {return num_cols;}
+    size_t stride() const {return row_stride;}
+    bool   empty()  const {return num_rows == 0 || num_cols == 0;}
+
+    T*       data()       {return buffer.get();}
+    const T* data() const {return buffer.get();}
+
+    //True if the buffer is backed by huge pages (or, for transparent huge pages, advised to be)
+    bool huge_pages() const {return buffer.get_deleter().huge;}
+
+    T*       operator[](const size_t& y)       {return buffer.get() + y * row_stride;}
+    const T* operator[](const size_t& y) const {return buffer.get() + y * row_stride;}
+
+    //Two matrices are equal if they have the same size and the same elements (padding is ignored)
+    bool operator==(const matrix_t& other) const {
+        if(num_rows != other.num_rows || num_cols != other.num_cols)
+            return false;
+
+        for(size_t y = 0; y < num_rows; ++y)
+            if(!std::equal((*this)[y], (*this)[y] + num_cols, other[y]))
+                return false;
+
+        return true;
+    }
+
+private:
+    //Frees the buffer, either allocated with new or mapped (when mapped_bytes isn't 0)
+    struct buffer_deleter {
+        size_t mapped_bytes = 0;
+        bool huge = false;
+
+        void operator()(T* p) const {
+#if ALYR_MMAP
+            if(mapped_bytes != 0){
+                ::munmap(p, mapped_bytes);
+                return;
+            }
+#endif
+            ::operator delete[](p, std::align_val_t(alignment));
+        }
+    };
+
+    //Number of elements of a row, rounded up so that every row starts aligned
+    static size_t padded_stride(const size_t& cols){
+        constexpr size_t elems_per_line = (alignment % sizeof(T) == 0) ? alignment / sizeof(T) : 1;
+        return (cols + elems_per_line - 1) / elems_per_line * elems_per_line;
+    }
+
+    static T* allocate(const size_t& elements){
+        return (elements == 0) ? nullptr : static_cast<T*>(::operator new[](elements * sizeof(T), std::align_val_t(alignment)));
+    }
+
+    //Map bytes of zeroed anonymous memory as the buffer, optionally backed by huge pages.
+    //Returns false if the memory couldn't be mapped
+    bool map_anonymous(const size_t& bytes, const bool& huge){
+#if ALYR_MMAP
+        if(bytes == 0)
+            return false;
+
+        void* p = MAP_FAILED;
+        size_t mapped_bytes = bytes;
+        bool hugetlb = false;
+#ifdef MAP_HUGETLB
+        //The length of the mappings of reserved huge pages is a multiple of their size (2 MiB by default)
+        if(huge){
+            constexpr size_t huge_page_size = size_t(2) << 20;
+            mapped_bytes = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+            p = ::mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            hugetlb = (p != MAP_FAILED);
+        }
+#endif
+        if(p == MAP_FAILED){
+            mapped_bytes = bytes;
+            p = ::mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(p == MAP_FAILED)
+                return false;
+        }
+
+        bool thp = false;
+#ifdef MADV_HUGEPAGE
+        if(huge && !hugetlb)
+            thp = (::madvise(p, mapped_bytes, MADV_HUGEPAGE) == 0);
+#endif
+
+        buffer = std::unique_ptr<T[], buffer_deleter>(static_cast<T*>(p), buffer_deleter{mapped_bytes, hugetlb || thp});
+        return true;
+#else
+        (void)bytes;
+        (void)huge;
+        return false;
+#endif
+    }
+
+    size_t num_rows;
+    size_t num_cols;
+    size_t row_stride;
+    std::unique_ptr<T[], buffer_deleter> buffer;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "alyr.hpp"
+#include "crc32.hpp"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+//Checkpoint file format ("<name>.expbin.ckpt", next to the exponent matrix file being rendered into):
+//  - magic "ALYRCKP" (8 bytes, null terminated)
+//  - side of the tiles (uint64), number of tiles (uint64),
+//    CRC-32 of the settings of the render (uint32), reserved (uint32)
+//  - one bit per tile, in row-major order, set if the tile has been completed and written to the matrix file
+//  - CRC-32 of all the previous bytes (uint32)
+//The tiles are the sectors of the render, and the partial matrix is the exponent matrix file itself
+
+static constexpr char checkpoint_magic[8] = "ALYRCKP";
+
+static uint32_t settings_crc(){
+    const std::string settings = alyr::internals::render_settings_str();
+    return crc32_bytes(0, reinterpret_cast<const unsigned char*>(settings.data()), settings.size());
+}
+
+//Save the bitmap of the completed tiles.
+//The checkpoint is written to a temporary file and then renamed, so that a render killed while saving it
+//still has the previous checkpoint
+int alyr::internals::save_checkpoint(const std::string& filename, const size_t& tile_size, const std::vector<bool>& completed_tiles){
+    std::string checkpoint;
+    const auto append = [&checkpoint](const auto& value){
+        checkpoint.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    checkpoint.append(checkpoint_magic, sizeof(checkpoint_magic));
+    append(static_cast<uint64_t>(tile_size));
+    append(static_cast<uint64_t>(completed_tiles.size()));
+    append(settings_crc());
+    append(uint32_t(0));    //Reserved
+
+    std::string bitmap((completed_tiles.size() + 7) / 8, '\0');
+    for(size_t t = 0; t < completed_tiles.size(); ++t)
+        if(completed_tiles[t])
+            bitmap[t / 8] |= static_cast<char>(1 << (t % 8));
+    checkpoint += bitmap;
+
+    append(crc32_bytes(0, reinterpret_cast<const unsigned char*>(checkpoint.data()), checkpoint.size()));
+
+    const std::string ckpt_filename = filename + ".expbin.ckpt";
+    std::ofstream out_file(ckpt_filename + ".tmp", std::ios::out | std::ios::binary);
+    if(!out_file.is_open())
+        return 1;
+
+    out_file.write(checkpoint.data(), checkpoint.size());
+    out_file.close();
+
+    if(!out_file || std::rename((ckpt_filename + ".tmp").c_str(), ckpt_filename.c_str()) != 0)
+        return 1;
+
+    return 0;
+}
+
+//Load the bitmap of the completed tiles, checking that it belongs to a render with the same settings
+int alyr::internals::load_checkpoint(const std::string& filename, const size_t& tile_size, const size_t& num_tiles, std::vector<bool>& completed_tiles){
+    std::ifstream in_file(filename + ".expbin.ckpt", std::ios::in | std::ios::binary);
+    if(!in_file.is_open()){
+        print_error("couldn't open checkpoint file to resume");
+        return 1;
+    }
+
+    const std::string checkpoint((std::istreambuf_iterator<char>(in_file)), std::istreambuf_iterator<char>());
+
+    const size_t bitmap_offset = sizeof(checkpoint_magic) + 2 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    const size_t bitmap_size   = (num_tiles + 7) / 8;
+    if(checkpoint.size() != bitmap_offset + bitmap_size + sizeof(uint32_t) ||
+       std::memcmp(checkpoint.data(), checkpoint_magic, sizeof(checkpoint_magic)) != 0){
+        print_error("checkpoint file is invalid or belongs to another render");
+        return 1;
+    }
+
+    uint64_t ckpt_tile_size = 0, ckpt_num_tiles = 0;
+    uint32_t ckpt_settings_crc = 0, ckpt_crc = 0;
+    std::memcpy(&ckpt_tile_size,    checkpoint.data() + sizeof(checkpoint_magic), sizeof(uint64_t));
+    std::memcpy(&ckpt_num_tiles,    checkpoint.data() + sizeof(checkpoint_magic) + sizeof(uint64_t), sizeof(uint64_t));
+    std::memcpy(&ckpt_settings_crc, checkpoint.data() + sizeof(checkpoint_magic) + 2 * sizeof(uint64_t), sizeof(uint32_t));
+    std::memcpy(&ckpt_crc,          checkpoint.data() + bitmap_offset + bitmap_size, sizeof(uint32_t));
+
+    if(crc32_bytes(0, reinterpret_cast<const unsigned char*>(checkpoint.data()), bitmap_offset + bitmap_size) != ckpt_crc){
+        print_error("checkpoint file is corrupted");
+        return 1;
+    }
+    if(ckpt_tile_size != tile_size || ckpt_num_tiles != num_tiles || ckpt_settings_crc != settings_crc()){
+        print_error("checkpoint file belongs to a render with different settings");
+        return 1;
+    }
+
+    completed_tiles.assign(num_tiles, false);
+    for(size_t t = 0; t < num_tiles; ++t)
+        completed_tiles[t] = (checkpoint[bitmap_offset + t / 8] >> (t % 8)) & 1;
+
+    return 0;
+}
+
+//Remove the checkpoint of a completed render
+void alyr::internals::remove_checkpoint(const std::string& filename){
+    std::remove((filename + ".expbin.ckpt").c_str());
+}
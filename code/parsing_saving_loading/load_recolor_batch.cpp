@@ -0,0 +1,135 @@
+#include "parse_options.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <set>
+
+using namespace std;
+using namespace alyr::internals;
+
+//Options that can be set for each variant of a batch recolor, the other ones are shared by the whole render
+static const set<cmdline_option> recolor_options{
+    cmdline_option::set_output_image_filename,
+    cmdline_option::set_low_pos_clamp,
+    cmdline_option::set_upp_pos_clamp,
+    cmdline_option::set_low_neg_clamp,
+    cmdline_option::set_upp_neg_clamp,
+    cmdline_option::set_pos_clamp_percentile,
+    cmdline_option::set_neg_clamp_percentile,
+    cmdline_option::set_npalette_filename,
+    cmdline_option::set_ppalette_filename,
+    cmdline_option::set_coloring_mode,
+    cmdline_option::enable_crosshair
+};
+
+//Coloring of the main image, as set by the current settings and palettes
+recolor_variant_t alyr::internals::current_recolor_variant(){
+    recolor_variant_t variant;
+    variant.image_name              = isettings.image_name;
+    variant.csettings               = csettings;
+    variant.npalette                = npalette;
+    variant.ppalette                = ppalette;
+    variant.lower_pos_clamp         = rsettings.lower_pos_clamp;
+    variant.upper_pos_clamp         = rsettings.upper_pos_clamp;
+    variant.lower_neg_clamp         = rsettings.lower_neg_clamp;
+    variant.upper_neg_clamp         = rsettings.upper_neg_clamp;
+    variant.pos_clamp_percentile    = rsettings.pos_clamp_percentile;
+    variant.neg_clamp_percentile    = rsettings.neg_clamp_percentile;
+
+    return variant;
+}
+
+//Function to load the variants of the batch recolor
+//Returns 0 if the loading was succesful, 1 if some warnings occurred, 2 if some errors occurred
+/*The batch recolor file should have the following format
+* -o <STRING> [coloring options]
+* -o <STRING> [coloring options]
+* [...]
+*
+* Each line is a variant, colored from the same exponent matrix as the main image and saved in "<STRING>.png".
+* The coloring options are the ones of the command line (palettes, coloring mode, clamps, crosshair),
+* and the ones not specified are taken from the command line. Empty lines and lines starting with '#' are skipped
+*/
+int alyr::load_recolor_batch(){
+    recolor_variants.clear();
+
+    if(csettings.batch_recolor_filename.empty())
+        return 0;
+
+    ifstream input_file(csettings.batch_recolor_filename, ifstream::in);
+    if(!input_file.is_open()){
+        print_error("batch recolor file could not be opened");
+        return 2;
+    }
+
+    //Settings of the command line, every variant starts from them
+    const imagesettings_t   base_isettings = isettings;
+    const colorsettings_t   base_csettings = csettings;
+    const rendersettings_t  base_rsettings = rsettings;
+    const auto base_npalette = npalette;
+    const auto base_ppalette = ppalette;
+
+    int ret_val = 0;
+
+    //Buffer to read the file line by line
+    string line;
+    size_t line_num = 0;
+    while(getline(input_file, line)){
+        ++line_num;
+        const string line_str = "line " + to_string(line_num) + " of batch recolor file";
+
+        //Split the line in options and their arguments
+        istringstream iss(line);
+        vector<string> options;
+        for(string token; iss >> token;)
+            options.push_back(token);
+
+        if(options.empty() || options.front().front() == '#')
+            continue;
+
+        //Only the coloring options can change between the variants, and every variant needs its own image
+        bool has_output_name = false;
+        for(size_t i = 0; i < options.size();){
+            const cmdline_option current_option =
+                map_str_to_cmdlineopt.contains(options[i]) ? map_str_to_cmdlineopt.at(options[i]) : cmdline_option::unknown;
+            if(!recolor_options.contains(current_option)){
+                print_error("\"" + options[i] + "\" can't be set in a batch recolor variant (" + line_str + ")");
+                return 2;
+            }
+            has_output_name |= (current_option == cmdline_option::set_output_image_filename);
+            i += map_cmdlineopt_num_elem_to_pop.at(current_option);
+        }
+        if(!has_output_name){
+            print_error("output image filename not specified (" + line_str + ")");
+            return 2;
+        }
+
+        //Parse the variant on top of the settings of the command line
+        if(parse_options(options) != 0){
+            print_error("couldn't parse " + line_str);
+            return 2;
+        }
+
+        //Load the palettes of the variant, if different from the ones of the command line
+        if(csettings.name_neg_palette != base_csettings.name_neg_palette ||
+           csettings.name_pos_palette != base_csettings.name_pos_palette){
+            const int palettes_ret_val = load_palettes();
+            if(palettes_ret_val >= 2){
+                print_error("couldn't load the palettes of " + line_str);
+                return 2;
+            }
+            ret_val = max(ret_val, palettes_ret_val);
+        }
+
+        recolor_variants.push_back(current_recolor_variant());
+
+        //Back to the settings of the command line
+        isettings = base_isettings;
+        csettings = base_csettings;
+        rsettings = base_rsettings;
+        npalette  = base_npalette;
+        ppalette  = base_ppalette;
+    }
+
+    return ret_val;
+}
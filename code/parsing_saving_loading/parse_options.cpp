@@ -109,6 +109,16 @@ int alyr::parse_options(std::vector<std::string> options){
                 consettings.verbose_output = true;
                 break;
 
+            //---------------------------------------------------------------------
+            case cmdline_option::set_progress_json_filename:
+                if(options.size() < 2){
+                    print_error("unspecified/specified progress JSON filename is invalid");
+                    return 2;
+                }
+
+                consettings.progress_json_filename = *(options.begin() + 1);
+                break;
+
             //---------------------------------------------------------------------
             case cmdline_option::set_width:
             {   size_t tmp_width;
@@ -165,6 +175,71 @@ int alyr::parse_options(std::vector<std::string> options){
                 }
                 break;
 
+            //---------------------------------------------------------------------
+            case cmdline_option::verify_lyap_exp_matrix:
+                rsettings.verify_exp_matrix = true;
+                break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::map_lyap_exp_matrix:
+                rsettings.map_exp_matrix = true;
+                break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_compression_level:
+            {   int tmp_level;
+                if(string_to_int(options, options.begin() + 1, tmp_level) || tmp_level < 0 || tmp_level > 9){
+                    print_error("unspecified/specified compression level is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.compression_level = tmp_level;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_checkpoint_interval:
+            {   size_t tmp_interval;
+                if(string_to_st(options, options.begin() + 1, tmp_interval)){
+                    print_error("unspecified/specified checkpoint interval is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.checkpoint_interval = tmp_interval;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_preview_interval:
+            {   size_t tmp_interval;
+                if(string_to_st(options, options.begin() + 1, tmp_interval)){
+                    print_error("unspecified/specified preview interval is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.preview_interval = tmp_interval;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::resume_render:
+                rsettings.resume_render = true;
+                break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::save_orbit_states:
+                rsettings.save_orbits = true;
+                break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::extend_orbit_states:
+                if(options.size() < 2){
+                    print_error("unspecified/specified orbit states filename is invalid");
+                    return 2;
+                }
+                else{
+                    rsettings.extend_orbits = true;
+                    rsettings.orbits_in_filename = *(options.begin() + 1);
+                }
+                break;
+
             //---------------------------------------------------------------------
             case cmdline_option::skip_coloring:
                 rsettings.skip_coloring = true;
@@ -181,6 +256,30 @@ int alyr::parse_options(std::vector<std::string> options){
                     rsettings.max_sector_size = tmp_secsize;
             }   break;
 
+            //---------------------------------------------------------------------
+            case cmdline_option::disable_adaptive_sectors:
+                rsettings.adaptive_sectors = false;
+                break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_sector_order:
+            {   sector_order tmp_order = sector_order::unknown;
+                if(options.size() < 2){
+                    print_error("not enought arguments have been provided to set the order of the sectors");
+                    return 2;
+                }
+
+                const string tmp_order_str = *(options.begin() + 1);
+                if(map_string_to_sector_order.contains(tmp_order_str))
+                    tmp_order = map_string_to_sector_order.at(tmp_order_str);
+                else{
+                    print_error("unspecified/specified order of the sectors is invalid");
+                    return 2;
+                }
+
+                rsettings.sectors_order = tmp_order;
+            }   break;
+
             //---------------------------------------------------------------------
             case cmdline_option::set_max_threads:
             {   size_t tmp_max_threads;
@@ -192,6 +291,84 @@ int alyr::parse_options(std::vector<std::string> options){
                     rsettings.max_threads = tmp_max_threads;
             }   break;
 
+            //---------------------------------------------------------------------
+            case cmdline_option::pin_threads:
+                rsettings.pin_threads = true;
+                break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::enable_huge_pages:
+                rsettings.huge_pages = true;
+                break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_float_type:
+            {   ftype tmp_float_type = ftype::unknown;
+                if(options.size() < 2){
+                    print_error("not enought arguments have been provided to set the floating point type");
+                    return 2;
+                }
+
+                const string tmp_float_type_str = *(options.begin() + 1);
+                if(map_string_to_ftype.contains(tmp_float_type_str))
+                    tmp_float_type = map_string_to_ftype.at(tmp_float_type_str);
+                else{
+                    print_error("unspecified/specified floating point type is invalid");
+                    return 2;
+                }
+
+                rsettings.float_type = tmp_float_type;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_exp_accumulation:
+            {   accumulation_mode tmp_acc_mode = accumulation_mode::unknown;
+                if(options.size() < 2){
+                    print_error("not enought arguments have been provided to set the accumulation mode");
+                    return 2;
+                }
+
+                const string tmp_acc_mode_str = *(options.begin() + 1);
+                if(map_string_to_accumulation_mode.contains(tmp_acc_mode_str))
+                    tmp_acc_mode = map_string_to_accumulation_mode.at(tmp_acc_mode_str);
+                else{
+                    print_error("unspecified/specified accumulation mode is invalid");
+                    return 2;
+                }
+
+                rsettings.exp_accumulation = tmp_acc_mode;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_storage_type:
+            {   storage_type tmp_storage_type = storage_type::unknown;
+                if(options.size() < 2){
+                    print_error("not enought arguments have been provided to set the storage type of the exponents");
+                    return 2;
+                }
+
+                const string tmp_storage_type_str = *(options.begin() + 1);
+                if(map_string_to_storage_type.contains(tmp_storage_type_str))
+                    tmp_storage_type = map_string_to_storage_type.at(tmp_storage_type_str);
+                else{
+                    print_error("unspecified/specified storage type of the exponents is invalid");
+                    return 2;
+                }
+
+                rsettings.exp_storage = tmp_storage_type;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_storage_scale:
+            {   long double tmp_scale;
+                if(string_to_ld(options, options.begin() + 1, tmp_scale) || !(tmp_scale > 0) || !isfinite(tmp_scale)){
+                    print_error("unspecified/specified quantization scale of the exponents is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.storage_scale = tmp_scale;
+            }   break;
+
             //---------------------------------------------------------------------
             case cmdline_option::set_map:
             {   mtype tmp_map_type = mtype::unknown;
@@ -349,6 +526,39 @@ int alyr::parse_options(std::vector<std::string> options){
                     rsettings.transient_iter = tmp_transient_iter;
             }   break;
 
+            //---------------------------------------------------------------------
+            case cmdline_option::set_cycle_tolerance:
+            {   long double tmp_tol;
+                if(string_to_ld(options, options.begin() + 1, tmp_tol) || tmp_tol < 0){
+                    print_error("unspecified/specified tolerance for the cycle detection is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.cycle_tolerance = tmp_tol;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_convergence_tolerance:
+            {   long double tmp_tol;
+                if(string_to_ld(options, options.begin() + 1, tmp_tol) || tmp_tol < 0){
+                    print_error("unspecified/specified tolerance for the convergence of the exponents is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.convergence_tolerance = tmp_tol;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_convergence_interval:
+            {   size_t tmp_interval;
+                if(string_to_st(options, options.begin() + 1, tmp_interval) || tmp_interval == 0){
+                    print_error("unspecified/specified interval between convergence checks is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.convergence_interval = tmp_interval;
+            }   break;
+
             //---------------------------------------------------------------------
             case cmdline_option::set_low_pos_clamp:
             {   long double tmp_low;
@@ -393,6 +603,28 @@ int alyr::parse_options(std::vector<std::string> options){
                     rsettings.upper_neg_clamp = tmp_upp;
             }   break;
 
+            //---------------------------------------------------------------------
+            case cmdline_option::set_pos_clamp_percentile:
+            {   long double tmp_perc;
+                if(string_to_ld(options, options.begin() + 1, tmp_perc) || !(tmp_perc > 0 && tmp_perc <= 100)){
+                    print_error("unspecified/specified clamping percentile for positive exponents is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.pos_clamp_percentile = tmp_perc;
+            }   break;
+
+            //---------------------------------------------------------------------
+            case cmdline_option::set_neg_clamp_percentile:
+            {   long double tmp_perc;
+                if(string_to_ld(options, options.begin() + 1, tmp_perc) || !(tmp_perc > 0 && tmp_perc <= 100)){
+                    print_error("unspecified/specified clamping percentile for negative exponents is invalid");
+                    return 2;
+                }
+                else
+                    rsettings.neg_clamp_percentile = tmp_perc;
+            }   break;
+
             //---------------------------------------------------------------------
             case cmdline_option::set_npalette_filename:
                 if(options.size() < 2)
@@ -433,6 +665,16 @@ int alyr::parse_options(std::vector<std::string> options){
                 csettings.draw_crosshair = true;
                 break;
 
+            //---------------------------------------------------------------------
+            case cmdline_option::set_batch_recolor_filename:
+                if(options.size() < 2){
+                    print_error("unspecified/specified batch recolor filename is invalid");
+                    return 2;
+                }
+
+                csettings.batch_recolor_filename = *(options.begin() + 1);
+                break;
+
             //---------------------------------------------------------------------
             case cmdline_option::unknown:
             //default:   this is omitted so that if an option is not switched the compiler gives a warning
@@ -24,16 +24,33 @@ int extract_n_numbers_from_vec(const std::vector<std::string>& stringvec, const
 enum class cmdline_option{
     print_help,
     enable_verbose,
+    set_progress_json_filename,
 
     set_width, set_height,
     set_output_image_filename,
 
     save_lyap_exp_matrix,
     load_lyap_exp_matrix,
+    verify_lyap_exp_matrix,
+    map_lyap_exp_matrix,
+    set_compression_level,
+    set_checkpoint_interval,
+    set_preview_interval,
+    resume_render,
+    save_orbit_states,
+    extend_orbit_states,
     skip_coloring,
 
     set_sector_size,
+    disable_adaptive_sectors,
+    set_sector_order,
     set_max_threads,
+    pin_threads,
+    enable_huge_pages,
+    set_float_type,
+    set_exp_accumulation,
+    set_storage_type,
+    set_storage_scale,
 
     set_map,
     set_sequence,
@@ -45,22 +62,29 @@ enum class cmdline_option{
 
     set_max_iterations,
     set_transient_iterations,
+    set_cycle_tolerance,
+    set_convergence_tolerance,
+    set_convergence_interval,
 
     set_low_pos_clamp,
     set_upp_pos_clamp,
     set_low_neg_clamp,
     set_upp_neg_clamp,
+    set_pos_clamp_percentile,
+    set_neg_clamp_percentile,
 
     set_npalette_filename,
     set_ppalette_filename,
     set_coloring_mode,
     enable_crosshair,
+    set_batch_recolor_filename,
     unknown
 };
 
 const std::map<cmdline_option, size_t> map_cmdlineopt_num_elem_to_pop{
     {cmdline_option::print_help, 1},
     {cmdline_option::enable_verbose, 1},
+    {cmdline_option::set_progress_json_filename, 2},
 
     {cmdline_option::set_width, 2},
     {cmdline_option::set_height, 2},
@@ -68,10 +92,26 @@ const std::map<cmdline_option, size_t> map_cmdlineopt_num_elem_to_pop{
 
     {cmdline_option::save_lyap_exp_matrix, 2},
     {cmdline_option::load_lyap_exp_matrix, 2},
+    {cmdline_option::verify_lyap_exp_matrix, 1},
+    {cmdline_option::map_lyap_exp_matrix, 1},
+    {cmdline_option::set_compression_level, 2},
+    {cmdline_option::set_checkpoint_interval, 2},
+    {cmdline_option::set_preview_interval, 2},
+    {cmdline_option::resume_render, 1},
+    {cmdline_option::save_orbit_states, 1},
+    {cmdline_option::extend_orbit_states, 2},
     {cmdline_option::skip_coloring, 1},
 
     {cmdline_option::set_sector_size, 2},
+    {cmdline_option::disable_adaptive_sectors, 1},
+    {cmdline_option::set_sector_order, 2},
     {cmdline_option::set_max_threads, 2},
+    {cmdline_option::pin_threads, 1},
+    {cmdline_option::enable_huge_pages, 1},
+    {cmdline_option::set_float_type, 2},
+    {cmdline_option::set_exp_accumulation, 2},
+    {cmdline_option::set_storage_type, 2},
+    {cmdline_option::set_storage_scale, 2},
 
     {cmdline_option::set_map, 2},
     {cmdline_option::set_sequence, 2},
@@ -87,16 +127,22 @@ const std::map<cmdline_option, size_t> map_cmdlineopt_num_elem_to_pop{
 
     {cmdline_option::set_max_iterations, 2},
     {cmdline_option::set_transient_iterations, 2},
+    {cmdline_option::set_cycle_tolerance, 2},
+    {cmdline_option::set_convergence_tolerance, 2},
+    {cmdline_option::set_convergence_interval, 2},
 
     {cmdline_option::set_low_pos_clamp, 2},
     {cmdline_option::set_upp_pos_clamp, 2},
     {cmdline_option::set_low_neg_clamp, 2},
     {cmdline_option::set_upp_neg_clamp, 2},
+    {cmdline_option::set_pos_clamp_percentile, 2},
+    {cmdline_option::set_neg_clamp_percentile, 2},
 
     {cmdline_option::set_npalette_filename, 2},
     {cmdline_option::set_ppalette_filename, 2},
     {cmdline_option::set_coloring_mode, 2},
     {cmdline_option::enable_crosshair, 1},
+    {cmdline_option::set_batch_recolor_filename, 2},
     {cmdline_option::unknown, 1}
 };
 
@@ -105,6 +151,8 @@ const std::map<std::string, cmdline_option> map_str_to_cmdlineopt{
     {"--help",          cmdline_option::print_help},
     {"-v",              cmdline_option::enable_verbose},
     {"--verbose",       cmdline_option::enable_verbose},
+    {"-pj",             cmdline_option::set_progress_json_filename},
+    {"--progress-json", cmdline_option::set_progress_json_filename},
 
     {"-w",              cmdline_option::set_width},
     {"--width",         cmdline_option::set_width},
@@ -119,14 +167,46 @@ const std::map<std::string, cmdline_option> map_str_to_cmdlineopt{
     {"-lm",             cmdline_option::load_lyap_exp_matrix},
     {"--load",          cmdline_option::load_lyap_exp_matrix},
     {"--load-matrix",   cmdline_option::load_lyap_exp_matrix},
+    {"-vm",             cmdline_option::verify_lyap_exp_matrix},
+    {"--verify-matrix", cmdline_option::verify_lyap_exp_matrix},
+    {"-mm",             cmdline_option::map_lyap_exp_matrix},
+    {"--mmap",          cmdline_option::map_lyap_exp_matrix},
+    {"-z",              cmdline_option::set_compression_level},
+    {"--compress",      cmdline_option::set_compression_level},
+    {"-ck",             cmdline_option::set_checkpoint_interval},
+    {"--checkpoint",    cmdline_option::set_checkpoint_interval},
+    {"-pv",             cmdline_option::set_preview_interval},
+    {"--preview",       cmdline_option::set_preview_interval},
+    {"-rs",             cmdline_option::resume_render},
+    {"--resume",        cmdline_option::resume_render},
+    {"-so",             cmdline_option::save_orbit_states},
+    {"--save-orbits",   cmdline_option::save_orbit_states},
+    {"-xo",             cmdline_option::extend_orbit_states},
+    {"--extend",        cmdline_option::extend_orbit_states},
 
     {"--skip",          cmdline_option::skip_coloring},
     {"--skip-coloring", cmdline_option::skip_coloring},
 
     {"-S",              cmdline_option::set_sector_size},
     {"--sector-size",   cmdline_option::set_sector_size},
+    {"-fs",             cmdline_option::disable_adaptive_sectors},
+    {"--fixed-sectors", cmdline_option::disable_adaptive_sectors},
+    {"-sor",            cmdline_option::set_sector_order},
+    {"--sector-order",  cmdline_option::set_sector_order},
     {"-T",              cmdline_option::set_max_threads},
     {"--max-threads",   cmdline_option::set_max_threads},
+    {"-pin",            cmdline_option::pin_threads},
+    {"--pin-threads",   cmdline_option::pin_threads},
+    {"-hp",             cmdline_option::enable_huge_pages},
+    {"--huge-pages",    cmdline_option::enable_huge_pages},
+    {"-ft",             cmdline_option::set_float_type},
+    {"--float-type",    cmdline_option::set_float_type},
+    {"-ea",             cmdline_option::set_exp_accumulation},
+    {"--exp-accumulation", cmdline_option::set_exp_accumulation},
+    {"-st",             cmdline_option::set_storage_type},
+    {"--storage-type",  cmdline_option::set_storage_type},
+    {"-ss",             cmdline_option::set_storage_scale},
+    {"--storage-scale", cmdline_option::set_storage_scale},
 
     {"-m",              cmdline_option::set_map},
     {"--map",           cmdline_option::set_map},
@@ -158,6 +238,12 @@ const std::map<std::string, cmdline_option> map_str_to_cmdlineopt{
     {"--max-iter",      cmdline_option::set_max_iterations},
     {"-tt",             cmdline_option::set_transient_iterations},
     {"--transient-iter",cmdline_option::set_transient_iterations},
+    {"-cd",             cmdline_option::set_cycle_tolerance},
+    {"--cycle-detection", cmdline_option::set_cycle_tolerance},
+    {"-ct",             cmdline_option::set_convergence_tolerance},
+    {"--convergence-tol", cmdline_option::set_convergence_tolerance},
+    {"-ci",             cmdline_option::set_convergence_interval},
+    {"--convergence-interval", cmdline_option::set_convergence_interval},
 
     {"-lpc",            cmdline_option::set_low_pos_clamp},
     {"--low-pos-clamp", cmdline_option::set_low_pos_clamp},
@@ -167,6 +253,10 @@ const std::map<std::string, cmdline_option> map_str_to_cmdlineopt{
     {"--low-neg-clamp", cmdline_option::set_low_neg_clamp},
     {"-unc",            cmdline_option::set_upp_neg_clamp},
     {"--upp-neg-clamp", cmdline_option::set_upp_neg_clamp},
+    {"-ppc",            cmdline_option::set_pos_clamp_percentile},
+    {"--pos-clamp-percentile", cmdline_option::set_pos_clamp_percentile},
+    {"-npc",            cmdline_option::set_neg_clamp_percentile},
+    {"--neg-clamp-percentile", cmdline_option::set_neg_clamp_percentile},
 
     {"-np",                 cmdline_option::set_npalette_filename},
     {"--npalette-filename", cmdline_option::set_npalette_filename},
@@ -175,7 +265,9 @@ const std::map<std::string, cmdline_option> map_str_to_cmdlineopt{
     {"-c",              cmdline_option::set_coloring_mode},
     {"--coloring-mode", cmdline_option::set_coloring_mode},
     {"-C",              cmdline_option::enable_crosshair},
-    {"--crosshair",     cmdline_option::enable_crosshair}
+    {"--crosshair",     cmdline_option::enable_crosshair},
+    {"-br",             cmdline_option::set_batch_recolor_filename},
+    {"--batch-recolor", cmdline_option::set_batch_recolor_filename}
 };
 
 const std::map<std::string, mtype> map_string_to_mtype{
@@ -185,9 +277,41 @@ const std::map<std::string, mtype> map_string_to_mtype{
     {"custom",      mtype::custom}
 };
 
+const std::map<std::string, ftype> map_string_to_ftype{
+    {"float",       ftype::float32},
+    {"double",      ftype::float64},
+    {"longdouble",  ftype::long_double},
+    {"long-double", ftype::long_double},
+#ifdef ALYR_FLOAT128
+    {"float128",    ftype::float128},
+    {"__float128",  ftype::float128}
+#endif
+};
+
+const std::map<std::string, accumulation_mode> map_string_to_accumulation_mode{
+    {"log",         accumulation_mode::log},
+    {"product",     accumulation_mode::product}
+};
+
+const std::map<std::string, storage_type> map_string_to_storage_type{
+    {"longdouble",  storage_type::long_double},
+    {"long-double", storage_type::long_double},
+    {"float",       storage_type::float32},
+    {"half",        storage_type::float16},
+    {"int16",       storage_type::int16}
+};
+
+const std::map<std::string, sector_order> map_string_to_sector_order{
+    {"row",         sector_order::row_major},
+    {"morton",      sector_order::morton},
+    {"hilbert",     sector_order::hilbert},
+    {"center",      sector_order::center_out}
+};
+
 const std::map<std::string, coloring_mode> map_string_to_coloring_mode{
     {"binary",      coloring_mode::binary},
-    {"linear",      coloring_mode::linear}
+    {"linear",      coloring_mode::linear},
+    {"histeq",      coloring_mode::histeq}
 };
 
 #endif
\ No newline at end of file
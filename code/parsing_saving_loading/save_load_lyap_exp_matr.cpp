@@ -1,9 +1,582 @@
 #include "alyr.hpp"
+#include "parse_options.hpp"
+#include "work_stealing_pool.hpp"
+#include "crc32.hpp"
 
 #include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <array>
+#include <zlib.h>
+
+//File formats
+//
+//Version 2:
+//  - fixed size header, with all the fields in the byte order of the machine that wrote the file:
+//      magic "ALYREXP" (8 bytes, null terminated), version (uint32), byte order mark 0x01020304 (uint32),
+//      storage type (uint32), size of a single element (uint32), number of rows (uint64), number of columns (uint64),
+//      quantization scale of storage_type::int16 (double), rows per checksum chunk (uint64),
+//      size of the settings (uint64), offset of the elements from the beginning of the file (uint64),
+//      CRC-32 of the header up to the elements, computed with this field set to 0 (uint32), reserved (uint32)
+//  - settings of the render, as "key=value" lines
+//  - CRC-32 of every chunk of rows of elements (uint32 each)
+//  - zeros up to the offset of the elements, which is a multiple of 64
+//  - the elements, row by row
+//
+//Version 3, tiled and compressed:
+//  - same fixed size header of version 2, with the side of the square tiles instead of the rows per checksum chunk,
+//    and the offset of the first tile instead of the offset of the elements
+//  - settings of the render, as "key=value" lines
+//  - index of the tiles, in row-major order: offset from the beginning of the file (uint64), compressed size (uint64),
+//    CRC-32 of the uncompressed elements (uint32), reserved (uint32)
+//  - zeros up to the offset of the first tile, which is a multiple of 64
+//  - the tiles, each compressed independently: the elements of the tile, row by row, with their bytes shuffled
+//    (first byte of all the elements, then the second byte of all the elements, ...) and compressed with deflate
+//
+//Version 1 (only loaded), the original format without a magic:
+//  - number of rows, number of columns, size of a single element (size_t)
+//  - the elements as long double, row by row
+
+static constexpr char     expbin_magic[8]       = "ALYREXP";
+static constexpr uint32_t expbin_version_raw    = 2;
+static constexpr uint32_t expbin_version_tiled  = 3;
+static constexpr uint32_t expbin_byte_order     = 0x01020304;
+static constexpr size_t   expbin_fixed_size     = 80;
+static constexpr size_t   expbin_crc_offset     = 72;
+static constexpr size_t   expbin_data_alignment = 64;
+static constexpr size_t   expbin_tile_entry_size = 24;
+//Approximate size of the chunks of rows covered by a single checksum
+static constexpr size_t   expbin_chunk_bytes    = 1 << 20;
+
+//Header of an exponent matrix file
+struct expbin_header_t {
+    uint32_t version;
+    size_t num_rows;
+    size_t num_cols;
+    storage_type stype;
+    long double scale;
+    //Size of the header in the file, the exponents start right after it
+    size_t size;
+
+    //Only in version 2
+    size_t chunk_rows;
+    std::vector<uint32_t> chunk_crcs;
+    //Only in version 3
+    size_t tile_size;
+    std::vector<size_t> tile_offsets;
+    std::vector<size_t> tile_sizes;
+    std::vector<uint32_t> tile_crcs;
+
+    //Version 2 and later
+    std::string settings;
+};
+
+//Number of rows covered by a single checksum
+static size_t expbin_chunk_rows(const size_t& num_cols, const storage_type& stype){
+    const size_t row_size = num_cols * lyap_exp_matrix_t::element_size(stype);
+    return std::max<size_t>(1, expbin_chunk_bytes / std::max<size_t>(1, row_size));
+}
+
+//CRC-32 of the c-th chunk of chunk_rows rows of the matrix
+static uint32_t expbin_chunk_crc(const lyap_exp_matrix_t& matr, const size_t& chunk_rows, const size_t& c){
+    const size_t row_size = matr.cols() * matr.elem_bytes();
+
+    uint32_t crc = 0;
+    for(size_t y = c * chunk_rows; y < std::min(matr.rows(), (c + 1) * chunk_rows); ++y)
+        crc = crc32_bytes(crc, matr.row_bytes(y), row_size);
+    return crc;
+}
+
+//CRC-32 of every chunk of chunk_rows rows of the matrix
+static std::vector<uint32_t> expbin_chunk_crcs(const lyap_exp_matrix_t& matr, const size_t& chunk_rows){
+    std::vector<uint32_t> crcs;
+    for(size_t c = 0; c * chunk_rows < matr.rows(); ++c)
+        crcs.push_back(expbin_chunk_crc(matr, chunk_rows, c));
+
+    return crcs;
+}
+
+//Name used for a value in the lookup tables of the command line options
+template<typename T>
+static std::string lookup_name(const std::map<std::string, T>& lookup_map, const T& value){
+    for(const auto& [name, map_value] : lookup_map)
+        if(map_value == value)
+            return name;
+    return "unknown";
+}
+
+//Settings of the current render, as "key=value" lines
+std::string alyr::internals::render_settings_str(){
+    using namespace alyr::internals;
+
+    std::ostringstream settings;
+    settings.precision(std::numeric_limits<long double>::max_digits10);
+
+    settings << "map=" << lookup_name(map_string_to_mtype, fsettings.map_type) << '\n';
+    settings << "sequence=";
+    for(const auto& rx : rx_sequence)
+        settings << ((rx == rxtype::A) ? 'A' : (rx == rxtype::B) ? 'B' : 'C');
+    settings << '\n';
+    settings << "x0_re=" << fsettings.x0.real() << '\n';
+    settings << "x0_im=" << fsettings.x0.imag() << '\n';
+    settings << "min_ra=" << fsettings.min_ra << '\n';
+    settings << "max_ra=" << fsettings.max_ra << '\n';
+    settings << "min_rb=" << fsettings.min_rb << '\n';
+    settings << "max_rb=" << fsettings.max_rb << '\n';
+    settings << "min_rc=" << fsettings.min_rc << '\n';
+    settings << "max_rc=" << fsettings.max_rc << '\n';
+
+    settings << "float_type=" << lookup_name(map_string_to_ftype, rsettings.float_type) << '\n';
+    settings << "exp_accumulation=" << lookup_name(map_string_to_accumulation_mode, rsettings.exp_accumulation) << '\n';
+    settings << "max_iter=" << rsettings.max_iter << '\n';
+    settings << "transient_iter=" << rsettings.transient_iter << '\n';
+    settings << "cycle_tolerance=" << rsettings.cycle_tolerance << '\n';
+    settings << "convergence_tolerance=" << rsettings.convergence_tolerance << '\n';
+    settings << "convergence_interval=" << rsettings.convergence_interval << '\n';
+
+    return settings.str();
+}
+
+//Restore the settings of the render that produced a file.
+//Unknown keys and invalid values are ignored
+static void restore_render_settings(const std::string& settings_str){
+    using namespace alyr::internals;
+
+    std::istringstream settings(settings_str);
+    std::string line;
+    while(std::getline(settings, line)){
+        const size_t eq_pos = line.find('=');
+        if(eq_pos == std::string::npos)
+            continue;
+
+        const std::string key   = line.substr(0, eq_pos);
+        const std::string value = line.substr(eq_pos + 1);
+
+        //Numeric values are converted only for the keys that need them
+        long double ld_value = 0;
+        size_t st_value = 0;
+        const auto is_ld = [&](){return string_to_ld(value, ld_value) == 0;};
+        const auto is_st = [&](){return string_to_st(value, st_value) == 0;};
+
+        if(key == "map" && map_string_to_mtype.contains(value))
+            fsettings.map_type = map_string_to_mtype.at(value);
+        else if(key == "sequence" && !value.empty() && value.find_first_not_of("ABC") == std::string::npos){
+            rx_sequence.clear();
+            for(const char& rx : value)
+                rx_sequence.push_back((rx == 'A') ? rxtype::A : (rx == 'B') ? rxtype::B : rxtype::C);
+        }
+        else if(key == "x0_re" && is_ld())                      fsettings.x0.real(ld_value);
+        else if(key == "x0_im" && is_ld())                      fsettings.x0.imag(ld_value);
+        else if(key == "min_ra" && is_ld())                     fsettings.min_ra = ld_value;
+        else if(key == "max_ra" && is_ld())                     fsettings.max_ra = ld_value;
+        else if(key == "min_rb" && is_ld())                     fsettings.min_rb = ld_value;
+        else if(key == "max_rb" && is_ld())                     fsettings.max_rb = ld_value;
+        else if(key == "min_rc" && is_ld())                     fsettings.min_rc = ld_value;
+        else if(key == "max_rc" && is_ld())                     fsettings.max_rc = ld_value;
+        else if(key == "float_type" && map_string_to_ftype.contains(value))
+            rsettings.float_type = map_string_to_ftype.at(value);
+        else if(key == "exp_accumulation" && map_string_to_accumulation_mode.contains(value))
+            rsettings.exp_accumulation = map_string_to_accumulation_mode.at(value);
+        else if(key == "max_iter" && is_st())                   rsettings.max_iter = st_value;
+        else if(key == "transient_iter" && is_st())             rsettings.transient_iter = st_value;
+        else if(key == "cycle_tolerance" && is_ld())            rsettings.cycle_tolerance = ld_value;
+        else if(key == "convergence_tolerance" && is_ld())      rsettings.convergence_tolerance = ld_value;
+        else if(key == "convergence_interval" && is_st())       rsettings.convergence_interval = st_value;
+    }
+}
+
+//Index of the checksums of the chunks of a file of version 2
+static std::string expbin_chunk_index(const std::vector<uint32_t>& chunk_crcs){
+    return std::string(reinterpret_cast<const char*>(chunk_crcs.data()), chunk_crcs.size() * sizeof(uint32_t));
+}
+
+//Index of the tiles of a file of version 3, whose first tile starts at first_offset
+static std::string expbin_tile_index(const std::vector<compressed_tile_t>& tiles, const size_t& first_offset){
+    std::string index;
+    const auto append = [&index](const auto& value){
+        index.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    size_t offset = first_offset;
+    for(const auto& tile : tiles){
+        append(static_cast<uint64_t>(offset));
+        append(static_cast<uint64_t>(tile.data.size()));
+        append(tile.crc);
+        append(uint32_t(0));    //Reserved
+        offset += tile.data.size();
+    }
+
+    return index;
+}
+
+//Offset of the data in a file, right after the header, settings and index
+static size_t expbin_data_offset(const size_t& settings_size, const size_t& index_size){
+    return (expbin_fixed_size + settings_size + index_size + expbin_data_alignment - 1) / expbin_data_alignment * expbin_data_alignment;
+}
+
+//Header (version 2 or 3) of a file containing a matrix of rows x cols exponents stored with the type stype,
+//up to the beginning of the elements.
+//block_size is the number of rows per checksum chunk (version 2) or the side of the tiles (version 3)
+static std::string expbin_header(const uint32_t& version,
+                                 const size_t& num_rows, const size_t& num_cols,
+                                 const storage_type& stype, const long double& scale,
+                                 const size_t& block_size,
+                                 const std::string& settings, const std::string& index)
+{
+    std::string header;
+    const auto append = [&header](const auto& value){
+        header.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    const size_t data_offset = expbin_data_offset(settings.size(), index.size());
+
+    header.append(expbin_magic, sizeof(expbin_magic));
+    append(version);
+    append(expbin_byte_order);
+    append(static_cast<uint32_t>(stype));
+    append(static_cast<uint32_t>(lyap_exp_matrix_t::element_size(stype)));
+    append(static_cast<uint64_t>(num_rows));
+    append(static_cast<uint64_t>(num_cols));
+    append(static_cast<double>(scale));
+    append(static_cast<uint64_t>(block_size));
+    append(static_cast<uint64_t>(settings.size()));
+    append(static_cast<uint64_t>(data_offset));
+    append(uint32_t(0));    //CRC of the header, filled below
+    append(uint32_t(0));    //Reserved
+
+    header += settings;
+    header += index;
+    header.resize(data_offset, '\0');
+
+    const uint32_t header_crc = crc32_bytes(0, reinterpret_cast<const unsigned char*>(header.data()), header.size());
+    std::memcpy(header.data() + expbin_crc_offset, &header_crc, sizeof(header_crc));
+
+    return header;
+}
+
+//Read the header from the first available bytes of a file of file_size bytes and check it against the size of the file.
+//Returns:
+// 0 -> OK
+// 1 -> invalid header
+// 2 -> the header is longer than the available bytes, header.size is set to its size
+static int parse_expbin_header(const unsigned char* data, const size_t& available, const size_t& file_size, expbin_header_t& header){
+    size_t offset = 0;
+    const auto read = [&](auto& value){
+        if(offset + sizeof(value) > available)
+            return false;
+        std::memcpy(&value, data + offset, sizeof(value));
+        offset += sizeof(value);
+        return true;
+    };
+
+    size_t size_single_element = 0;
+
+    //Version 2 and 3
+    if(available >= sizeof(expbin_magic) && std::memcmp(data, expbin_magic, sizeof(expbin_magic)) == 0){
+        offset = sizeof(expbin_magic);
+
+        uint32_t byte_order = 0, stype_id = 0, elem_size = 0;
+        uint64_t num_rows = 0, num_cols = 0, block_size = 0, settings_size = 0, data_offset = 0;
+        double scale = 0;
+        uint32_t header_crc = 0;
+
+        if(!read(header.version) || !read(byte_order) || !read(stype_id) || !read(elem_size) ||
+           !read(num_rows) || !read(num_cols) || !read(scale) ||
+           !read(block_size) || !read(settings_size) || !read(data_offset) || !read(header_crc)){
+            alyr::internals::print_error("couldn't load header from exponent matrix file");
+            return 1;
+        }
+        if(byte_order != expbin_byte_order){
+            alyr::internals::print_error("couldn't load exponent matrix file, it has been saved with a different byte order");
+            return 1;
+        }
+        if(header.version != expbin_version_raw && header.version != expbin_version_tiled){
+            alyr::internals::print_error("couldn't load exponent matrix file, version " + std::to_string(header.version) + " is not supported");
+            return 1;
+        }
+
+        header.num_rows   = num_rows;
+        header.num_cols   = num_cols;
+        header.stype      = (stype_id < static_cast<uint32_t>(storage_type::unknown)) ? static_cast<storage_type>(stype_id) : storage_type::unknown;
+        header.scale      = scale;
+        header.size       = data_offset;
+        size_single_element = elem_size;
+
+        //Number of checksums or tiles in the index
+        size_t index_entries = 0;
+        size_t index_size = 0;
+        if(block_size != 0 && header.version == expbin_version_raw){
+            header.chunk_rows = block_size;
+            index_entries = (num_rows + block_size - 1) / block_size;
+            index_size = index_entries * sizeof(uint32_t);
+        }
+        else if(block_size != 0){
+            header.tile_size = block_size;
+            index_entries = ((num_rows + block_size - 1) / block_size) * ((num_cols + block_size - 1) / block_size);
+            index_size = index_entries * expbin_tile_entry_size;
+        }
+
+        if(block_size == 0 || data_offset < expbin_fixed_size + settings_size + index_size || data_offset > file_size){
+            alyr::internals::print_error("couldn't load exponent matrix file, header is invalid");
+            return 1;
+        }
+        if(data_offset > available)
+            return 2;
+
+        //Check the header itself
+        std::string header_copy(reinterpret_cast<const char*>(data), data_offset);
+        std::memset(header_copy.data() + expbin_crc_offset, 0, sizeof(uint32_t));
+        if(crc32_bytes(0, reinterpret_cast<const unsigned char*>(header_copy.data()), header_copy.size()) != header_crc){
+            alyr::internals::print_error("couldn't load exponent matrix file, header is corrupted");
+            return 1;
+        }
+
+        header.settings.assign(reinterpret_cast<const char*>(data) + expbin_fixed_size, settings_size);
+        offset = expbin_fixed_size + settings_size;
+        if(header.version == expbin_version_raw){
+            header.chunk_crcs.resize(index_entries);
+            for(auto& crc : header.chunk_crcs)
+                read(crc);
+        }
+        else{
+            header.tile_offsets.resize(index_entries);
+            header.tile_sizes.resize(index_entries);
+            header.tile_crcs.resize(index_entries);
+            for(size_t t = 0; t < index_entries; ++t){
+                uint64_t tile_offset = 0, tile_size = 0;
+                uint32_t reserved = 0;
+                read(tile_offset);
+                read(tile_size);
+                read(header.tile_crcs[t]);
+                read(reserved);
+
+                if(tile_offset < data_offset || tile_size > file_size || tile_offset > file_size - tile_size){
+                    alyr::internals::print_error("couldn't load exponent matrix file, index of the tiles is invalid");
+                    return 1;
+                }
+                header.tile_offsets[t] = tile_offset;
+                header.tile_sizes[t]   = tile_size;
+            }
+        }
+    }
+    //Version 1
+    else{
+        header.version = 1;
+        if(!read(header.num_rows) || !read(header.num_cols) || !read(size_single_element)){
+            alyr::internals::print_error("couldn't load header from exponent matrix file");
+            return 1;
+        }
+
+        //The elements are always long double, any other size is rejected by the checks below
+        header.stype = storage_type::long_double;
+        header.scale = lyap_exp_matrix_t::default_qint16_scale;
+        header.size = offset;
+    }
+
+    //Other checks on the header and on the size of the file
+    if(lyap_exp_matrix_t::element_size(header.stype) != size_single_element){
+        alyr::internals::print_error("couldn't load exponent matrix file, element type is invalid");
+        return 1;
+    }
+    if(header.version != expbin_version_tiled && file_size != header.size + header.num_rows * header.num_cols * size_single_element){
+        alyr::internals::print_error("couldn't load exponent matrix file, size is invalid");
+        return 1;
+    }
+
+    return 0;
+}
+
+//Compare the checksums of the exponents with the ones in the header of the file they've been loaded from,
+//every chunk in parallel on the workers of pool.
+//Returns 0 if they match (or if the file has no checksums)
+static int check_expbin_chunks(const lyap_exp_matrix_t& matr, const expbin_header_t& header, work_stealing_pool_t& pool){
+    if(header.version != expbin_version_raw)
+        return 0;
+
+    //Result of the check of every chunk
+    std::vector<int> matching_chunks(header.chunk_crcs.size(), 0);
+    pool.parallel_for(matching_chunks.size(), [&](const size_t& c, const size_t&){
+        matching_chunks[c] = (expbin_chunk_crc(matr, header.chunk_rows, c) == header.chunk_crcs[c]);
+    });
+
+    for(size_t c = 0; c < matching_chunks.size(); ++c){
+        if(!matching_chunks[c]){
+            alyr::internals::print_error("exponent matrix file is corrupted, rows " +
+                                         std::to_string(c * header.chunk_rows) + " to " +
+                                         std::to_string(std::min(matr.rows(), (c + 1) * header.chunk_rows) - 1) +
+                                         " don't match their checksum");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+//Read the header of a file, in two steps if it's bigger than the fixed part.
+//Returns 0 on success
+static int read_expbin_header(std::ifstream& in_file, const size_t& file_size, expbin_header_t& header){
+    //The fixed part of version 2 is longer than the whole header of version 1
+    std::string header_data(std::min(file_size, expbin_fixed_size), '\0');
+    in_file.seekg(0);
+    in_file.read(header_data.data(), header_data.size());
+
+    int ret = parse_expbin_header(reinterpret_cast<const unsigned char*>(header_data.data()), header_data.size(), file_size, header);
+    if(ret == 2){
+        header_data.resize(header.size);
+        in_file.seekg(0);
+        in_file.read(header_data.data(), header_data.size());
+        ret = parse_expbin_header(reinterpret_cast<const unsigned char*>(header_data.data()), header_data.size(), file_size, header);
+    }
+
+    in_file.seekg(header.size);
+    return (ret == 0 && in_file) ? 0 : 1;
+}
+
+//Rectangle {start_x, start_y, end_x, end_y} covered by the t-th tile of a matrix, with the tiles in row-major order
+static std::array<size_t, 4> expbin_tile_rect(const size_t& t, const size_t& tile_size, const size_t& num_rows, const size_t& num_cols){
+    const size_t tiles_x = (num_cols + tile_size - 1) / tile_size;
+    const size_t start_x = (t % tiles_x) * tile_size;
+    const size_t start_y = (t / tiles_x) * tile_size;
+    return {start_x, start_y, std::min(start_x + tile_size, num_cols), std::min(start_y + tile_size, num_rows)};
+}
+
+//Decompress the t-th tile of a file of version 3 and check it against its checksum.
+//If matr is not nullptr, the exponents are copied into it.
+//Returns 0 on success
+static int inflate_expbin_tile(const unsigned char* file_data, const expbin_header_t& header, const size_t& t, lyap_exp_matrix_t* matr){
+    const auto [start_x, start_y, end_x, end_y] = expbin_tile_rect(t, header.tile_size, header.num_rows, header.num_cols);
+    const size_t elem_size = lyap_exp_matrix_t::element_size(header.stype);
+    const size_t num_elems = (end_x - start_x) * (end_y - start_y);
+    const size_t row_size  = (end_x - start_x) * elem_size;
+
+    std::vector<unsigned char> shuffled(num_elems * elem_size);
+    uLongf inflated_size = shuffled.size();
+    if(uncompress(shuffled.data(), &inflated_size, file_data + header.tile_offsets[t], header.tile_sizes[t]) != Z_OK ||
+       inflated_size != shuffled.size())
+        return 1;
+
+    //Undo the byte shuffle
+    std::vector<unsigned char> raw(shuffled.size());
+    for(size_t b = 0; b < elem_size; ++b)
+        for(size_t i = 0; i < num_elems; ++i)
+            raw[i * elem_size + b] = shuffled[b * num_elems + i];
+
+    if(crc32_bytes(0, raw.data(), raw.size()) != header.tile_crcs[t])
+        return 1;
+
+    if(matr != nullptr)
+        for(size_t y = start_y; y < end_y; ++y)
+            std::memcpy(matr->row_bytes(y) + start_x * elem_size, raw.data() + (y - start_y) * row_size, row_size);
+
+    return 0;
+}
+
+//Decompress all the tiles of a file of version 3 in parallel on the workers of pool, returns an empty matrix on failure
+static lyap_exp_matrix_t inflate_expbin_tiles(const unsigned char* file_data, const expbin_header_t& header, work_stealing_pool_t& pool){
+    lyap_exp_matrix_t matr(header.num_rows, header.num_cols, header.stype, header.scale);
+
+    //Result of the decompression of every tile
+    std::vector<int> inflated_tiles(header.tile_offsets.size(), 0);
+    pool.parallel_for(inflated_tiles.size(), [&](const size_t& t, const size_t&){
+        inflated_tiles[t] = inflate_expbin_tile(file_data, header, t, &matr);
+    });
+
+    for(size_t t = 0; t < inflated_tiles.size(); ++t){
+        if(inflated_tiles[t] != 0){
+            alyr::internals::print_error("exponent matrix file is corrupted, tile " + std::to_string(t) + " doesn't match its checksum");
+            return lyap_exp_matrix_t();
+        }
+    }
+
+    return matr;
+}
+
+//Number of tiles of side tile_size in a matrix
+size_t alyr::internals::lyap_exp_tile_count(const size_t& num_rows, const size_t& num_cols, const size_t& tile_size){
+    return ((num_rows + tile_size - 1) / tile_size) * ((num_cols + tile_size - 1) / tile_size);
+}
+
+//Compress a tile of the matrix: its bytes are shuffled, so that the bytes with the same significance of all the exponents
+//are next to each other (sign and exponent bytes are very repetitive), and then deflated
+compressed_tile_t alyr::internals::compress_lyap_exp_tile(const lyap_exp_matrix_t& matr,
+                                                          const size_t& start_x, const size_t& start_y,
+                                                          const size_t& end_x,   const size_t& end_y,
+                                                          const int& level)
+{
+    compressed_tile_t tile;
+    const size_t elem_size = matr.elem_bytes();
+    const size_t num_elems = (end_x - start_x) * (end_y - start_y);
+    const size_t row_size  = (end_x - start_x) * elem_size;
+
+    //Exponents of the tile, row by row
+    std::vector<unsigned char> raw(num_elems * elem_size);
+    for(size_t y = start_y; y < end_y; ++y)
+        std::memcpy(raw.data() + (y - start_y) * row_size, matr.row_bytes(y) + start_x * elem_size, row_size);
+    tile.crc = crc32_bytes(0, raw.data(), raw.size());
+
+    std::vector<unsigned char> shuffled(raw.size());
+    for(size_t i = 0; i < num_elems; ++i)
+        for(size_t b = 0; b < elem_size; ++b)
+            shuffled[b * num_elems + i] = raw[i * elem_size + b];
+
+    uLongf compressed_size = compressBound(shuffled.size());
+    tile.data.resize(compressed_size);
+    if(compress2(reinterpret_cast<Bytef*>(tile.data.data()), &compressed_size, shuffled.data(), shuffled.size(), level) != Z_OK)
+        compressed_size = 0;
+    tile.data.resize(compressed_size);
+
+    return tile;
+}
+
+//Save Lyapunov exponent matrix to a tiled and compressed file.
+//The tiles already compressed by the workers are reused, the others are compressed here
+int alyr::internals::save_compressed_lyap_exp_matrix(const lyap_exp_matrix_t& matr, const size_t& tile_size, const int& level,
+                                                     std::vector<compressed_tile_t>& tiles, const std::string& filename)
+{
+    const size_t num_tiles = lyap_exp_tile_count(matr.rows(), matr.cols(), tile_size);
+    tiles.resize(num_tiles);
+
+    for(size_t t = 0; t < num_tiles; ++t){
+        if(tiles[t].data.empty()){
+            const auto [start_x, start_y, end_x, end_y] = expbin_tile_rect(t, tile_size, matr.rows(), matr.cols());
+            tiles[t] = compress_lyap_exp_tile(matr, start_x, start_y, end_x, end_y, level);
+
+            if(tiles[t].data.empty()){
+                print_error("couldn't compress exponent matrix");
+                return 1;
+            }
+        }
+    }
+
+    std::ofstream out_file(filename + ".expbin", std::ios::out | std::ios::binary);
+
+    if(!out_file.is_open()){
+        print_error("couldn't open exponent matrix file for saving");
+        return 1;
+    }
+
+    const std::string settings = render_settings_str();
+    const size_t data_offset = expbin_data_offset(settings.size(), num_tiles * expbin_tile_entry_size);
+    const std::string header = expbin_header(expbin_version_tiled, matr.rows(), matr.cols(), matr.type(), matr.scale(), tile_size,
+                                             settings, expbin_tile_index(tiles, data_offset));
+    out_file.write(header.data(), header.size());
+
+    for(const auto& tile : tiles)
+        out_file.write(tile.data.data(), tile.data.size());
+
+    out_file.close();
+
+    if(!out_file){
+        print_error("couldn't write exponent matrix file");
+        return 1;
+    }
+
+    return 0;
+}
 
 //Save Lyapunov exponent matrix to file
-int alyr::internals::save_lyap_exp_matrix(const std::vector<std::vector<long double>>& matr, const std::string& filename){
+int alyr::internals::save_lyap_exp_matrix(const lyap_exp_matrix_t& matr, const std::string& filename){
     std::ofstream out_file(filename + ".expbin", std::ios::out | std::ios::binary);
 
     if(!out_file.is_open()){
@@ -12,70 +585,223 @@ int alyr::internals::save_lyap_exp_matrix(const std::vector<std::vector<long dou
     }
 
     //Dimensions of the matrix
-    const size_t num_rows = matr.size();
-    const size_t num_cols = matr.front().size();
+    const size_t num_rows = matr.rows();
+    const size_t num_cols = matr.cols();
 
     //Dimension of the single element of the matrix
-    const size_t size_single_element = sizeof(long double);
+    const size_t size_single_element = matr.elem_bytes();
 
     //Start writing data to file
-    out_file.write(reinterpret_cast<const char*>(&num_rows), sizeof(num_rows));
-    out_file.write(reinterpret_cast<const char*>(&num_cols), sizeof(num_cols));
-    out_file.write(reinterpret_cast<const char*>(&size_single_element), sizeof(size_single_element));
+    const size_t chunk_rows = expbin_chunk_rows(num_cols, matr.type());
+    const std::string header = expbin_header(expbin_version_raw, num_rows, num_cols, matr.type(), matr.scale(), chunk_rows,
+                                             render_settings_str(), expbin_chunk_index(expbin_chunk_crcs(matr, chunk_rows)));
+    out_file.write(header.data(), header.size());
 
     //Write entire matrix to file, row by row
-    for(size_t y = 0; y < num_rows; ++y){
-        for(size_t x = 0; x < num_cols; ++x){
-            out_file.write(reinterpret_cast<const char*>(&matr[y][x]), size_single_element);
-        }
-    }
+    for(size_t y = 0; y < num_rows; ++y)
+        out_file.write(reinterpret_cast<const char*>(matr.row_bytes(y)), num_cols * size_single_element);
 
     //Close the file
     out_file.close();
 
+    if(!out_file){
+        print_error("couldn't write exponent matrix file");
+        return 1;
+    }
+
     return 0;
 }
 
-//Load Lyapunov exponent matrix from file
-std::vector<std::vector<long double>> alyr::internals::load_lyap_exp_matrix(const std::string& filename){
-    std::vector<std::vector<long double>> ret_matr;
-
+//Check a saved file against its checksums, reading it one chunk at a time
+int alyr::internals::verify_lyap_exp_matrix(const std::string& filename){
     std::ifstream in_file(filename + ".expbin", std::ios::in | std::ios::ate | std::ios::binary);
 
-    if(!in_file.is_open())
-        print_error("couldn't open exponent matrix file for loading");
+    if(!in_file.is_open()){
+        print_error("couldn't open exponent matrix file for checking");
+        return 1;
+    }
+
+    const size_t file_size = in_file.tellg();
+    expbin_header_t header;
+    if(read_expbin_header(in_file, file_size, header) != 0)
+        return 1;
+
+    if(header.version < 2){
+        print_warning("exponent matrix file has no checksums");
+        return 0;
+    }
+
+    //Tiled files are small, they're read entirely and every tile is decompressed and checked
+    if(header.version == expbin_version_tiled){
+        std::vector<unsigned char> file_data(file_size);
+        in_file.seekg(0);
+        in_file.read(reinterpret_cast<char*>(file_data.data()), file_size);
+
+        for(size_t t = 0; t < header.tile_offsets.size(); ++t){
+            if(!in_file || inflate_expbin_tile(file_data.data(), header, t, nullptr) != 0){
+                print_error("exponent matrix file doesn't match its checksums");
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    const size_t row_size = header.num_cols * lyap_exp_matrix_t::element_size(header.stype);
+    std::vector<unsigned char> chunk(header.chunk_rows * row_size);
+    for(size_t c = 0; c < header.chunk_crcs.size(); ++c){
+        const size_t chunk_size = (std::min(header.num_rows, (c + 1) * header.chunk_rows) - c * header.chunk_rows) * row_size;
+        in_file.read(reinterpret_cast<char*>(chunk.data()), chunk_size);
+
+        if(!in_file || crc32_bytes(0, chunk.data(), chunk_size) != header.chunk_crcs[c]){
+            print_error("exponent matrix file doesn't match its checksums");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+//Create the exponent matrix file at its final size and map it in memory, so that the exponents are
+//written directly to the file.
+//The checksums are written by sync_mapped_lyap_exp_matrix, once all the exponents have been calculated
+lyap_exp_matrix_t alyr::internals::create_mapped_lyap_exp_matrix(const size_t& num_rows, const size_t& num_cols,
+                                                                 const storage_type& stype, const long double& scale,
+                                                                 const std::string& filename)
+{
+    const size_t chunk_rows = expbin_chunk_rows(num_cols, stype);
+    const std::vector<uint32_t> empty_crcs((num_rows + chunk_rows - 1) / chunk_rows, 0);
+
+    const std::string header = expbin_header(expbin_version_raw, num_rows, num_cols, stype, scale, chunk_rows,
+                                             render_settings_str(), expbin_chunk_index(empty_crcs));
+    const size_t file_size = header.size() + num_rows * num_cols * lyap_exp_matrix_t::element_size(stype);
+
+    mapped_file_t file;
+    if(file.create(filename + ".expbin", file_size) != 0){
+        print_error("couldn't create and map exponent matrix file");
+        return lyap_exp_matrix_t();
+    }
+
+    std::copy(header.begin(), header.end(), file.data());
+
+    return lyap_exp_matrix_t(std::move(file), header.size(), num_rows, num_cols, stype, scale);
+}
+
+//Map an existing exponent matrix file, created by create_mapped_lyap_exp_matrix with the same settings,
+//to continue the render that was writing it
+lyap_exp_matrix_t alyr::internals::open_mapped_lyap_exp_matrix(const size_t& num_rows, const size_t& num_cols,
+                                                               const storage_type& stype, const long double& scale,
+                                                               const std::string& filename)
+{
+    mapped_file_t file;
+    if(file.open_write(filename + ".expbin") != 0){
+        print_error("couldn't open and map exponent matrix file to resume");
+        return lyap_exp_matrix_t();
+    }
+
+    expbin_header_t header;
+    if(parse_expbin_header(file.data(), file.size(), file.size(), header) != 0)
+        return lyap_exp_matrix_t();
+
+    if(header.version != expbin_version_raw ||
+       header.num_rows != num_rows || header.num_cols != num_cols ||
+       header.stype != stype || header.scale != static_cast<double>(scale) ||
+       header.settings != render_settings_str()){
+        print_error("exponent matrix file to resume has been rendered with different settings");
+        return lyap_exp_matrix_t();
+    }
+
+    return lyap_exp_matrix_t(std::move(file), header.size, num_rows, num_cols, stype, scale);
+}
+
+//Write the checksums of a mapped exponent matrix to its header and the whole file to the disk
+int alyr::internals::sync_mapped_lyap_exp_matrix(lyap_exp_matrix_t& matr){
+    mapped_file_t* file = matr.mapped_file();
+    if(file == nullptr)
+        return 1;
+
+    expbin_header_t header;
+    if(parse_expbin_header(file->data(), file->size(), file->size(), header) != 0)
+        return 1;
+
+    const std::string new_header = expbin_header(expbin_version_raw, header.num_rows, header.num_cols, header.stype, header.scale,
+                                                 header.chunk_rows, header.settings,
+                                                 expbin_chunk_index(expbin_chunk_crcs(matr, header.chunk_rows)));
+    if(new_header.size() != header.size)
+        return 1;
+    std::copy(new_header.begin(), new_header.end(), file->data());
+
+    return file->sync();
+}
+
+//Load Lyapunov exponent matrix from file.
+//The file is mapped in memory read only, so that the exponents are used directly from the page cache without copying them;
+//if it can't be mapped, it's read in RAM.
+//The exponents read in RAM or decompressed are checked against the checksums of the file; the ones of a mapped file are
+//checked only if required, as the check would read the whole file (the header, settings and checksums are always checked).
+//The tiles are decompressed and the exponents are checked on the workers of pool.
+//The settings of the render that produced them are restored
+lyap_exp_matrix_t alyr::internals::load_lyap_exp_matrix(const std::string& filename, work_stealing_pool_t& pool){
+    lyap_exp_matrix_t ret_matr;
+    expbin_header_t header;
+
+    mapped_file_t file;
+    if(file.open_read(filename + ".expbin") == 0){
+        if(parse_expbin_header(file.data(), file.size(), file.size(), header) != 0)
+            return lyap_exp_matrix_t();
+
+        if(header.version == expbin_version_tiled)
+            ret_matr = inflate_expbin_tiles(file.data(), header, pool);
+        else
+            ret_matr = lyap_exp_matrix_t(std::move(file), header.size, header.num_rows, header.num_cols, header.stype, header.scale);
+    }
     else{
+        std::ifstream in_file(filename + ".expbin", std::ios::in | std::ios::ate | std::ios::binary);
+
+        if(!in_file.is_open()){
+            print_error("couldn't open exponent matrix file for loading");
+            return lyap_exp_matrix_t();
+        }
+
         const size_t file_size = in_file.tellg();
-        in_file.seekg(std::ios::beg);
+        if(read_expbin_header(in_file, file_size, header) != 0)
+            return lyap_exp_matrix_t();
 
-        //First checks on size of the file
-        if(file_size < 3 * sizeof(size_t))
-            print_error("couldn't load header from exponent matrix file");
+        if(header.version == expbin_version_tiled){
+            //Read the whole file and decompress it
+            std::vector<unsigned char> file_data(file_size);
+            in_file.seekg(0);
+            in_file.read(reinterpret_cast<char*>(file_data.data()), file_size);
+
+            if(!in_file){
+                print_error("couldn't read exponent matrix file");
+                return lyap_exp_matrix_t();
+            }
+
+            ret_matr = inflate_expbin_tiles(file_data.data(), header, pool);
+        }
         else{
-            size_t num_rows = 0;
-            size_t num_cols = 0;
-            size_t size_single_element = 0;
-
-            //Read header
-            in_file.read(reinterpret_cast<char*>(&num_rows), sizeof(size_t));
-            in_file.read(reinterpret_cast<char*>(&num_cols), sizeof(size_t));
-            in_file.read(reinterpret_cast<char*>(&size_single_element), sizeof(size_t));
-
-            //Other checks on size of the file
-            if(file_size != 3 * sizeof(size_t) + num_rows*num_cols*size_single_element)
-                print_error("couldn't load exponent matrix file, size is invalid");
-            else{
-                ret_matr = std::vector<std::vector<long double>>(num_rows, std::vector<long double>(num_cols, 0));
-
-                //Write entire matrix to file, row by row
-                for(size_t y = 0; y < num_rows; ++y){
-                    for(size_t x = 0; x < num_cols; ++x){
-                        in_file.read(reinterpret_cast<char*>(&ret_matr[y][x]), size_single_element);
-                    }
-                }
+            ret_matr = lyap_exp_matrix_t(header.num_rows, header.num_cols, header.stype, header.scale);
+
+            //Read entire matrix from file, row by row
+            const size_t row_size = header.num_cols * ret_matr.elem_bytes();
+            for(size_t y = 0; y < header.num_rows; ++y)
+                in_file.read(reinterpret_cast<char*>(ret_matr.row_bytes(y)), row_size);
+
+            if(!in_file){
+                print_error("couldn't read exponent matrix file");
+                return lyap_exp_matrix_t();
             }
         }
     }
 
+    if(ret_matr.empty())
+        return lyap_exp_matrix_t();
+
+    if((!ret_matr.is_mapped() || rsettings.verify_exp_matrix) && check_expbin_chunks(ret_matr, header, pool) != 0)
+        return lyap_exp_matrix_t();
+
+    restore_render_settings(header.settings);
+
     return ret_matr;
-}
\ No newline at end of file
+}
@@ -0,0 +1,228 @@
+#include "alyr.hpp"
+#include "crc32.hpp"
+#include "mapped_file.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <tuple>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Orbit states file format ("<name>.orbits"):
+//  - fixed size header, with all the fields in the byte order of the machine that wrote the file:
+//      magic "ALYRORB" (8 bytes, null terminated), version (uint32), byte order mark 0x01020304 (uint32),
+//      size of a single state (uint32), reserved (uint32), number of rows (uint64), number of columns (uint64),
+//      iterations performed by the render (uint64), size of the settings (uint64)
+//  - settings of the render, as "key=value" lines (the same saved in the exponent matrix files)
+//  - the states of the orbits (orbit_state_t), row by row
+//  - CRC-32 of all the previous bytes (uint32)
+
+static constexpr char     orbits_magic[8]   = "ALYRORB";
+static constexpr uint32_t orbits_version    = 1;
+static constexpr uint32_t orbits_byte_order = 0x01020304;
+static constexpr size_t   orbits_fixed_size = 56;
+
+//Settings without the number of iterations, which is the only one allowed to change when extending a render
+static std::string settings_without_max_iter(const std::string& settings_str){
+    std::istringstream settings(settings_str);
+    std::string line, stripped;
+    while(std::getline(settings, line))
+        if(line.rfind("max_iter=", 0) != 0)
+            stripped += line + '\n';
+    return stripped;
+}
+
+//Write a state in sizeof(orbit_state_t) bytes, field by field, with all the padding bytes zeroed
+//(the ones between the fields and the ones of the long doubles) so that equal states are saved as equal bytes
+static void store_orbit_state(unsigned char* p, const orbit_state_t& state){
+    std::memset(p, 0, sizeof(orbit_state_t));
+    store_long_double(p + offsetof(orbit_state_t, xn), state.xn.real());
+    store_long_double(p + offsetof(orbit_state_t, xn) + sizeof(long double), state.xn.imag());
+    store_long_double(p + offsetof(orbit_state_t, log_sum), state.log_sum);
+    std::memcpy(p + offsetof(orbit_state_t, iter_count), &state.iter_count, sizeof(state.iter_count));
+    std::memcpy(p + offsetof(orbit_state_t, finished),   &state.finished,   sizeof(state.finished));
+}
+
+//Save the states of the orbits of all the pixels
+int alyr::internals::save_orbit_states(const orbit_matrix_t& states, const std::string& filename){
+    std::ofstream out_file(filename + ".orbits", std::ios::out | std::ios::binary);
+    if(!out_file.is_open()){
+        print_error("couldn't open orbit states file for writing");
+        return 1;
+    }
+
+    const std::string settings = render_settings_str();
+
+    std::string header;
+    const auto append = [&header](const auto& value){
+        header.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    header.append(orbits_magic, sizeof(orbits_magic));
+    append(orbits_version);
+    append(orbits_byte_order);
+    append(static_cast<uint32_t>(sizeof(orbit_state_t)));
+    append(uint32_t(0));    //Reserved
+    append(static_cast<uint64_t>(states.rows()));
+    append(static_cast<uint64_t>(states.cols()));
+    append(static_cast<uint64_t>(rsettings.max_iter));
+    append(static_cast<uint64_t>(settings.size()));
+    header += settings;
+
+    uint32_t crc = crc32_bytes(0, reinterpret_cast<const unsigned char*>(header.data()), header.size());
+    out_file.write(header.data(), header.size());
+
+    std::vector<unsigned char> row(states.cols() * sizeof(orbit_state_t));
+    for(size_t y = 0; y < states.rows(); ++y){
+        for(size_t x = 0; x < states.cols(); ++x)
+            store_orbit_state(row.data() + x * sizeof(orbit_state_t), states[y][x]);
+        crc = crc32_bytes(crc, row.data(), row.size());
+        out_file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    out_file.write(reinterpret_cast<const char*>(&crc), sizeof(crc));
+    out_file.close();
+
+    if(!out_file){
+        print_error("couldn't write orbit states file");
+        return 1;
+    }
+
+    return 0;
+}
+
+//Copy the states of the orbits from a mapped file, at data, into the matrix, every sector on the worker of the pool
+//which takes it, and check them against the CRC-32 of the file, whose previous bytes have the CRC-32 crc.
+//The CRC-32 of the row of every sector is computed while copying it, and they're combined in the order of the file.
+//Returns 0 on success
+static int copy_orbit_states(const unsigned char* data, uint32_t crc, orbit_matrix_t& states,
+                             work_stealing_pool_t& pool, const std::vector<std::array<size_t, 4>>& sectors){
+    //Position in the file (row and first column) and CRC-32 of the rows of every sector
+    std::vector<std::vector<std::tuple<size_t, size_t, uint32_t>>> sector_crcs(sectors.size());
+    pool.parallel_for(sectors.size(), [&](const size_t& i, const size_t&){
+        const auto [start_x, start_y, end_x, end_y] = sectors[i];
+        const size_t size = (end_x - start_x) * sizeof(orbit_state_t);
+        for(size_t y = start_y; y < end_y; ++y){
+            const unsigned char* src = data + (y * states.cols() + start_x) * sizeof(orbit_state_t);
+            std::memcpy(&states[y][start_x], src, size);
+            sector_crcs[i].emplace_back(y, start_x, crc32_bytes(0, src, size));
+        }
+    });
+
+    std::vector<std::tuple<size_t, size_t, uint32_t>> row_crcs;
+    for(const auto& c : sector_crcs)
+        row_crcs.insert(row_crcs.end(), c.begin(), c.end());
+    std::sort(row_crcs.begin(), row_crcs.end());
+
+    //The rows of the sectors have to cover all the states, one after the other
+    size_t next = 0;
+    for(size_t i = 0; i < row_crcs.size(); ++i){
+        const auto& [y, start_x, row_crc] = row_crcs[i];
+        const size_t end_x = (i + 1 < row_crcs.size() && std::get<0>(row_crcs[i + 1]) == y) ? std::get<1>(row_crcs[i + 1]) : states.cols();
+        if(y * states.cols() + start_x != next)
+            return 1;
+        crc = crc32_combine(crc, row_crc, (end_x - start_x) * sizeof(orbit_state_t));
+        next = y * states.cols() + end_x;
+    }
+    if(next != states.rows() * states.cols())
+        return 1;
+
+    uint32_t file_crc = 0;
+    std::memcpy(&file_crc, data + next * sizeof(orbit_state_t), sizeof(file_crc));
+    return (file_crc == crc) ? 0 : 1;
+}
+
+//Load the states of the orbits saved by a render with the same settings and at most as many iterations.
+//The file is mapped if possible, and the states of every sector are copied by the worker of the pool which takes it,
+//so that the pages of a matrix not allocated as filled are placed where it will continue the orbits; otherwise the file is read in RAM
+orbit_matrix_t alyr::internals::load_orbit_states(const std::string& filename, const matrix_alloc& alloc,
+                                                  work_stealing_pool_t& pool, const std::vector<std::array<size_t, 4>>& sectors){
+    std::ifstream in_file(filename + ".orbits", std::ios::in | std::ios::binary);
+    if(!in_file.is_open()){
+        print_error("couldn't open orbit states file");
+        return orbit_matrix_t();
+    }
+
+    //Fixed size header
+    char header[orbits_fixed_size];
+    if(!in_file.read(header, orbits_fixed_size) || std::memcmp(header, orbits_magic, sizeof(orbits_magic)) != 0){
+        print_error("orbit states file is invalid");
+        return orbit_matrix_t();
+    }
+
+    uint32_t version = 0, byte_order = 0, state_size = 0;
+    uint64_t num_rows = 0, num_cols = 0, max_iter = 0, settings_size = 0;
+    std::memcpy(&version,       header + 8,  sizeof(version));
+    std::memcpy(&byte_order,    header + 12, sizeof(byte_order));
+    std::memcpy(&state_size,    header + 16, sizeof(state_size));
+    std::memcpy(&num_rows,      header + 24, sizeof(num_rows));
+    std::memcpy(&num_cols,      header + 32, sizeof(num_cols));
+    std::memcpy(&max_iter,      header + 40, sizeof(max_iter));
+    std::memcpy(&settings_size, header + 48, sizeof(settings_size));
+
+    if(version != orbits_version || byte_order != orbits_byte_order || state_size != sizeof(orbit_state_t)){
+        print_error("orbit states file has been written by an incompatible version or machine");
+        return orbit_matrix_t();
+    }
+    if(settings_size > (1 << 20)){
+        print_error("orbit states file is invalid");
+        return orbit_matrix_t();
+    }
+
+    std::string settings(settings_size, '\0');
+    if(!in_file.read(settings.data(), settings_size)){
+        print_error("orbit states file is truncated");
+        return orbit_matrix_t();
+    }
+
+    //The orbits can only be continued with the same settings, on the same pixels, up to more iterations
+    if(num_rows != isettings.image_height || num_cols != isettings.image_width ||
+       settings_without_max_iter(settings) != settings_without_max_iter(render_settings_str())){
+        print_error("orbit states file has been saved by a render with different settings");
+        return orbit_matrix_t();
+    }
+    if(max_iter > rsettings.max_iter){
+        print_error("orbit states file has been saved by a render with more iterations (" + std::to_string(max_iter) + ")");
+        return orbit_matrix_t();
+    }
+
+    uint32_t crc = crc32_bytes(0, reinterpret_cast<const unsigned char*>(header), orbits_fixed_size);
+    crc = crc32_bytes(crc, reinterpret_cast<const unsigned char*>(settings.data()), settings.size());
+
+    orbit_matrix_t states(num_rows, num_cols, alloc);
+    const size_t data_offset = orbits_fixed_size + settings_size;
+    const size_t data_size   = num_rows * num_cols * sizeof(orbit_state_t);
+
+    mapped_file_t file;
+    if(file.open_read(filename + ".orbits") == 0){
+        if(file.size() != data_offset + data_size + sizeof(uint32_t)){
+            print_error("orbit states file is truncated");
+            return orbit_matrix_t();
+        }
+        if(copy_orbit_states(file.data() + data_offset, crc, states, pool, sectors) != 0){
+            print_error("orbit states file is corrupted");
+            return orbit_matrix_t();
+        }
+        return states;
+    }
+
+    const size_t row_size = num_cols * sizeof(orbit_state_t);
+    for(size_t y = 0; y < num_rows; ++y){
+        char* row = reinterpret_cast<char*>(states[y]);
+        if(!in_file.read(row, row_size)){
+            print_error("orbit states file is truncated");
+            return orbit_matrix_t();
+        }
+        crc = crc32_bytes(crc, reinterpret_cast<const unsigned char*>(row), row_size);
+    }
+
+    uint32_t file_crc = 0;
+    if(!in_file.read(reinterpret_cast<char*>(&file_crc), sizeof(file_crc)) || file_crc != crc){
+        print_error("orbit states file is corrupted");
+        return orbit_matrix_t();
+    }
+
+    return states;
+}
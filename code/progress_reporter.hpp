@@ -0,0 +1,250 @@
+#ifndef PROGRESS_REPORTER_HPP_INCLUDED
+#define PROGRESS_REPORTER_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include(<unistd.h>)
+    #include <cstdio>
+    #include <unistd.h>
+#endif
+
+//Whether the standard output is a terminal, where a line can be overwritten in place.
+//Assumed to be one where it can't be checked
+inline bool stdout_is_terminal(){
+#if __has_include(<unistd.h>)
+    return isatty(fileno(stdout)) != 0;
+#else
+    return true;
+#endif
+}
+
+//Progress of a phase of the render (calculating or coloring the exponents), counted by the workers without locks.
+//Every worker has its own counters of the completed sectors, pixels and iterations and of the time spent working,
+//and a reporter thread periodically sums them to print the completion state, the throughput, the estimated time left
+//and the utilization of the workers, and optionally writes them as JSON lines (one object per report) to a stream.
+//A console which isn't a terminal (a log file or a pipe) only gets the final report, as its lines can't be overwritten
+class progress_reporter_t {
+public:
+    //Progress of a phase with the given totals, of which done_sectors and done_pixels were already completed
+    //(by an interrupted render). Reports go to the console and/or the JSON stream, if not null,
+    //and the periodic ones go to the console only if it's a terminal (_console_live)
+    progress_reporter_t(const std::string& _phase, const size_t& num_workers,
+                        const size_t& _total_sectors, const size_t& _total_pixels,
+                        const size_t& _done_sectors, const size_t& _done_pixels,
+                        std::ostream* _console, const bool& _console_live, std::ostream* _json) :
+        phase(_phase),
+        counters(num_workers),
+        total_sectors(_total_sectors), total_pixels(_total_pixels),
+        done_sectors(_done_sectors), done_pixels(_done_pixels),
+        console(_console), console_live(_console_live), json(_json),
+        start_time(std::chrono::steady_clock::now()),
+        stop(false), finished(false)
+    {
+        if((console != nullptr && console_live) || json != nullptr)
+            reporter = std::thread([this](){reporter_loop();});
+    }
+
+    ~progress_reporter_t(){
+        finish();
+    }
+
+    progress_reporter_t(const progress_reporter_t&) = delete;
+    progress_reporter_t& operator=(const progress_reporter_t&) = delete;
+
+    //A worker started working on a block
+    void begin_work(const size_t& worker){
+        counters[worker].busy_since.store(elapsed_ns(), std::memory_order_relaxed);
+    }
+
+    //A worker completed a block, which completed the given number of sectors, pixels and iterations
+    void end_work(const size_t& worker, const size_t& sectors, const size_t& pixels, const size_t& iterations){
+        auto& c = counters[worker];
+        c.busy_ns.fetch_add(elapsed_ns() - c.busy_since.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        c.busy_since.store(-1, std::memory_order_relaxed);
+        c.sectors.fetch_add(sectors, std::memory_order_relaxed);
+        c.pixels.fetch_add(pixels, std::memory_order_relaxed);
+        c.iterations.fetch_add(iterations, std::memory_order_relaxed);
+    }
+
+    //Stop the reporter and write the final report, once the phase is completed
+    void finish(){
+        if(finished)
+            return;
+        finished = true;
+
+        if(reporter.joinable()){
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stop = true;
+            }
+            stop_cv.notify_all();
+            reporter.join();
+        }
+        if(console != nullptr || json != nullptr)
+            report(true);
+    }
+
+private:
+    //Interval between the reports on the console, and between the ones in the JSON stream
+    static constexpr std::chrono::milliseconds console_interval{200};
+    static constexpr std::chrono::milliseconds json_interval{1000};
+
+    //Counters of a worker, each on its own cache line
+    struct alignas(64) worker_counters_t {
+        std::atomic<uint64_t> sectors{0};
+        std::atomic<uint64_t> pixels{0};
+        std::atomic<uint64_t> iterations{0};
+        std::atomic<int64_t> busy_ns{0};
+        //Start of the block the worker is working on, -1 if idle
+        std::atomic<int64_t> busy_since{-1};
+    };
+
+    //Sum of the counters of all the workers
+    struct snapshot_t {
+        double seconds;
+        uint64_t sectors;
+        uint64_t pixels;
+        uint64_t iterations;
+        std::vector<double> utilization;
+    };
+
+    int64_t elapsed_ns() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+    }
+
+    snapshot_t take_snapshot() const {
+        snapshot_t s{0, 0, 0, 0, {}};
+        const int64_t now = elapsed_ns();
+        s.seconds = static_cast<double>(now) * 1e-9;
+        for(const auto& c : counters){
+            s.sectors    += c.sectors.load(std::memory_order_relaxed);
+            s.pixels     += c.pixels.load(std::memory_order_relaxed);
+            s.iterations += c.iterations.load(std::memory_order_relaxed);
+
+            //The time spent on the current block counts as working too
+            const int64_t since = c.busy_since.load(std::memory_order_relaxed);
+            const int64_t busy = c.busy_ns.load(std::memory_order_relaxed) + (since >= 0 ? now - since : 0);
+            s.utilization.push_back(now > 0 ? std::clamp(static_cast<double>(busy) / static_cast<double>(now), 0.0, 1.0) : 0.0);
+        }
+        return s;
+    }
+
+    //Value with an SI prefix, for the rates
+    static std::string si_prefixed(double value){
+        static const char* const prefixes[] = {"", "k", "M", "G", "T", "P"};
+        size_t p = 0;
+        while(value >= 1000 && p < 5){
+            value /= 1000;
+            ++p;
+        }
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2) << value << " " << prefixes[p];
+        return oss.str();
+    }
+
+    //Duration as hours, minutes and seconds
+    static std::string hms(const double& seconds){
+        const uint64_t s = static_cast<uint64_t>(seconds + 0.5);
+        std::ostringstream oss;
+        oss << s / 3600 << ":" << std::setfill('0') << std::setw(2) << (s / 60) % 60 << ":" << std::setw(2) << s % 60;
+        return oss.str();
+    }
+
+    void report(const bool& final){
+        const snapshot_t s = take_snapshot();
+        const double pixels_per_s     = s.seconds > 0 ? static_cast<double>(s.pixels) / s.seconds : 0;
+        const double iterations_per_s = s.seconds > 0 ? static_cast<double>(s.iterations) / s.seconds : 0;
+        const double pixels_left      = static_cast<double>(total_pixels - std::min<uint64_t>(total_pixels, done_pixels + s.pixels));
+        const bool eta_known          = final || pixels_per_s > 0;
+        const double eta              = final ? 0 : (eta_known ? pixels_left / pixels_per_s : 0);
+
+        if(console != nullptr && (final || console_live)){
+            double avg_utilization = 0, min_utilization = 1;
+            for(const auto& u : s.utilization){
+                avg_utilization += u / static_cast<double>(s.utilization.size());
+                min_utilization = std::min(min_utilization, u);
+            }
+
+            std::ostringstream line;
+            line << "Completed sectors (" << phase << "): " << done_sectors + s.sectors << "/" << total_sectors
+                 << ", " << si_prefixed(pixels_per_s) << "px/s";
+            if(s.iterations != 0)
+                line << ", " << si_prefixed(iterations_per_s) << "iter/s";
+            if(final)
+                line << ", in " << hms(s.seconds);
+            else
+                line << ", ETA " << (eta_known ? hms(eta) : std::string("--"));
+            line << ", utilization " << static_cast<int>(avg_utilization * 100 + 0.5) << "%"
+                 << " (min " << static_cast<int>(min_utilization * 100 + 0.5) << "%)";
+
+            //Padded to overwrite the longer lines printed before
+            if(console_live)
+                *console << std::left << std::setw(100) << line.str() << std::right << (final ? "\n" : "\r") << std::flush;
+            else
+                *console << line.str() << "\n" << std::flush;
+        }
+
+        if(json != nullptr && (final || std::chrono::steady_clock::now() >= next_json)){
+            next_json = std::chrono::steady_clock::now() + json_interval;
+
+            *json << "{\"phase\":\"" << phase << "\""
+                  << ",\"elapsed_s\":" << s.seconds
+                  << ",\"sectors\":" << done_sectors + s.sectors << ",\"total_sectors\":" << total_sectors
+                  << ",\"pixels\":" << done_pixels + s.pixels << ",\"total_pixels\":" << total_pixels
+                  << ",\"iterations\":" << s.iterations
+                  << ",\"pixels_per_s\":" << pixels_per_s
+                  << ",\"iterations_per_s\":" << iterations_per_s
+                  << ",\"eta_s\":";
+            if(eta_known)
+                *json << eta;
+            else
+                *json << "null";
+            *json << ",\"utilization\":[";
+            for(size_t w = 0; w < s.utilization.size(); ++w)
+                *json << (w == 0 ? "" : ",") << s.utilization[w];
+            *json << "],\"done\":" << (final ? "true" : "false") << "}\n" << std::flush;
+        }
+    }
+
+    void reporter_loop(){
+        const std::chrono::milliseconds interval = (console != nullptr && console_live) ? console_interval : json_interval;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(!stop_cv.wait_for(lock, interval, [this](){return stop;})){
+            lock.unlock();
+            report(false);
+            lock.lock();
+        }
+    }
+
+    const std::string phase;
+    std::vector<worker_counters_t> counters;
+    const uint64_t total_sectors;
+    const uint64_t total_pixels;
+    const uint64_t done_sectors;
+    const uint64_t done_pixels;
+
+    std::ostream* const console;
+    const bool console_live;
+    std::ostream* const json;
+    const std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point next_json;
+
+    std::thread reporter;
+    std::mutex mutex;
+    std::condition_variable stop_cv;
+    bool stop;
+    bool finished;
+};
+
+#endif
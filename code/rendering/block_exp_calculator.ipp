@@ -6,38 +6,74 @@
 #include <cmath>
 
 //Block renderer
-template<map_fn_ptr_t map_fn, map_der_fn_ptr_t map_der_fn>
-void alyr::internals::block_exp_calculator(const size_t& img_width, const size_t& img_height,
+template<typename T, accumulation_mode acc_mode, map_fn_ptr_t<T> map_fn, map_der_fn_ptr_t<T> map_der_fn>
+blockstats_t alyr::internals::block_exp_calculator(const size_t& img_width, const size_t& img_height,
                                            const size_t& start_x, const size_t& start_y,
                                            const size_t& end_x, const size_t& end_y,
-                                           std::vector<std::vector<long double>>& lyap_exp_matr){
+                                           const size_t& max_iter,
+                                           lyap_exp_matrix_t& lyap_exp_matr,
+                                           orbit_matrix_t* orbits){
     
     //Auxiliary variables
     //
+    const T ln2 = std::log(T{2});
+    const T renorm_upper_bound = fp_half_range_bound<T>();
+    const T renorm_lower_bound = T{1} / renorm_upper_bound;
+
+    //Continue the orbits of a previous render
+    const bool extend_orbits = orbits != nullptr && rsettings.extend_orbits;
+
+    //Iterations performed on the pixels of the block and statistics of their exponents
+    blockstats_t block_stats;
 
     //Iterate over all the pixels in the block
-    for(size_t x = start_x; x < end_x; ++x){
-        for(size_t y = start_y; y < end_y; ++y){
+    for(size_t y = start_y; y < end_y; ++y){
+        for(size_t x = start_x; x < end_x; ++x){
             //Initialize r for iteration A and r for interation B
-            const long double ra = std::lerp(fsettings.min_ra, fsettings.max_ra, static_cast<long double>(img_height - 1 - y) / static_cast<long double>(img_height  - 1));
-            const long double rb = std::lerp(fsettings.min_rb, fsettings.max_rb, static_cast<long double>(x) / static_cast<long double>(img_width - 1));
+            const T ra = fp_lerp<T>(fsettings.min_ra, fsettings.max_ra, static_cast<T>(img_height - 1 - y) / static_cast<T>(img_height  - 1));
+            const T rb = fp_lerp<T>(fsettings.min_rb, fsettings.max_rb, static_cast<T>(x) / static_cast<T>(img_width - 1));
 
             //Initialize xn, n-th element of the sequence to the initial value
-            std::complex<long double> xn = fsettings.x0;
+            std::complex<T> xn(static_cast<T>(fsettings.x0.real()), static_cast<T>(fsettings.x0.imag()));
 
             //Initialize accumulator for Lyapunov exponent
-            long double lyap_exp = 0;
+            T lyap_exp = 0;
+
+            //Initialize running product of the squared norms of the derivatives and its binary exponent,
+            //and the sum accumulated before it by a previous render
+            //(only used in accumulation_mode::product)
+            T der_prod = 1;
+            long long der_prod_exp = 0;
+            T prev_sum = 0;
 
             //Set iteration count to 0
             size_t iter_count = 0;
 
+            //Continue from the saved state of the orbit. Finished orbits keep their exponent
+            if(extend_orbits){
+                const orbit_state_t& state = (*orbits)[y][x];
+                if(state.finished){
+                    lyap_exp_matr.set(y, x, state.log_sum);
+                    block_stats.add(0, lyap_exp_matr.get(y, x));
+                    continue;
+                }
+
+                xn = std::complex<T>(static_cast<T>(state.xn.real()), static_cast<T>(state.xn.imag()));
+                iter_count = state.iter_count;
+                if constexpr (acc_mode == accumulation_mode::product)
+                    prev_sum = static_cast<T>(state.log_sum);
+                else
+                    lyap_exp = static_cast<T>(state.log_sum);
+            }
+            const size_t start_iter = iter_count;
+
             //Main iterating loop
-            while(iter_count < rsettings.max_iter && std::isfinite(lyap_exp)){
+            while(iter_count < max_iter && std::isfinite(lyap_exp)){
                 //Calculate current r to use
                 const rxtype current_rx_type = rx_sequence[iter_count % rx_sequence.size()];
 
                 //Set selected r
-                long double selected_rx = 0;
+                T selected_rx = 0;
                 switch(current_rx_type){
                     default:
                     case rxtype::A:
@@ -51,26 +87,589 @@ void alyr::internals::block_exp_calculator(const size_t& img_width, const size_t
 
                 //Update the value of xn and of the Lyapunov exponent
                 xn        = (*map_fn)(xn, selected_rx);
-                if(iter_count > rsettings.transient_iter)
-                    lyap_exp += 0.5l * std::log(std::norm((*map_der_fn)(xn, selected_rx)));
+                if(iter_count > rsettings.transient_iter){
+                    if constexpr (acc_mode == accumulation_mode::product){
+                        der_prod *= std::norm((*map_der_fn)(xn, selected_rx));
+
+                        //Pull out the exponent before the product can over/underflow
+                        if(!(der_prod >= renorm_lower_bound && der_prod <= renorm_upper_bound)){
+                            if(der_prod == 0 || !std::isfinite(der_prod))
+                                break;
+
+                            int e;
+                            der_prod = fp_frexp(der_prod, e);
+                            der_prod_exp += e;
+                        }
+                    }
+                    else
+                        lyap_exp += T{0.5} * std::log(std::norm((*map_der_fn)(xn, selected_rx)));
+                }
 
                 //Increment iteration count
                 ++iter_count;
             }
-            
+
+            if constexpr (acc_mode == accumulation_mode::product)
+                lyap_exp = prev_sum + T{0.5} * (static_cast<T>(der_prod_exp) * ln2 + std::log(der_prod));
+            const T log_sum = lyap_exp;
+
             //Take average
             if(iter_count > rsettings.transient_iter)
-                lyap_exp /= static_cast<long double>(iter_count - rsettings.transient_iter);
+                lyap_exp /= static_cast<T>(iter_count - rsettings.transient_iter);
             else
-                lyap_exp /= static_cast<long double>(iter_count);
+                lyap_exp /= static_cast<T>(iter_count);
             //std::cout << x << ", " << y << " : r = (a = " << ra << ", b = " << rb << ") : exp = " << lyap_exp << std::endl;
 
             //Compute color of pixel
             //image_to_write[x][y] = compute_color(lyap_exp, xn);
             //image_to_write[y][x] = (lyap_exp < 0 ? png::rgb_pixel(255, 255, 0) : png::rgb_pixel(0, 0, 255));
-            lyap_exp_matr[y][x] = lyap_exp;
+            lyap_exp_matr.set(y, x, static_cast<long double>(lyap_exp));
+            block_stats.add(iter_count - start_iter, lyap_exp_matr.get(y, x));
+
+            //Save the state of the orbit. Only non-finite exponents are final
+            if(orbits != nullptr){
+                const bool finished = !std::isfinite(lyap_exp);
+                (*orbits)[y][x] = orbit_state_t{std::complex<long double>(static_cast<long double>(xn.real()), static_cast<long double>(xn.imag())),
+                                                static_cast<long double>(finished ? lyap_exp : log_sum),
+                                                iter_count, finished};
+            }
+        }
+    }
+
+    return block_stats;
+}
+
+//Block renderer, specialized for a real x0
+//When x0 is real, xn and the derivative of the map stay on the real axis for the whole orbit,
+//so the exponent can be accumulated as log|f'(xn)| on plain scalars.
+//If period != 0 the kernel is specialized for sequences of that length: the values of r are precomputed for
+//every pixel and the main loop is unrolled over one full period of the sequence
+template<typename T, accumulation_mode acc_mode, size_t period, real_map_fn_ptr_t<T> map_fn, real_map_der_fn_ptr_t<T> map_der_fn>
+blockstats_t alyr::internals::block_exp_calculator_real(const size_t& img_width, const size_t& img_height,
+                                                const size_t& start_x, const size_t& start_y,
+                                                const size_t& end_x, const size_t& end_y,
+                                                const size_t& max_iter,
+                                                lyap_exp_matrix_t& lyap_exp_matr,
+                                                orbit_matrix_t* orbits){
+
+    //Auxiliary variables
+    const T ln2 = fp_log(T{2});
+    const T renorm_upper_bound = fp_half_range_bound<T>();
+    const T renorm_lower_bound = T{1} / renorm_upper_bound;
+
+    //Number of iterations a pixel which stays finite is averaged on
+    const T avg_count = static_cast<T>((max_iter > rsettings.transient_iter) ?
+                                       max_iter - rsettings.transient_iter :
+                                       max_iter);
+
+    //Orbit classification, disabled if the tolerance is 0.
+    //Orbits going past divergence_bound are considered divergent
+    const bool detect_cycles = rsettings.cycle_tolerance > 0;
+    const T cycle_tol = static_cast<T>(rsettings.cycle_tolerance);
+    const T divergence_bound = static_cast<T>(1e10l);
+
+    //Early exit once the running estimate of the exponent changes by less than the tolerance
+    //between two checks, done every conv_check_periods periods of the sequence. Disabled if the tolerance is 0
+    const bool detect_convergence = rsettings.convergence_tolerance > 0;
+    const T conv_tol = static_cast<T>(rsettings.convergence_tolerance);
+
+    //Length of the sequence and first iteration contributing to the exponent
+    const size_t seq_len   = (period == 0) ? rx_sequence.size() : period;
+    const size_t acc_start = std::min(rsettings.transient_iter + 1, max_iter);
+    const size_t conv_check_periods = std::max<size_t>(1, (rsettings.convergence_interval + seq_len - 1) / seq_len);
+
+    //Sequence rotated so that it starts from the element used in iteration acc_start
+    std::vector<rxtype> rotated_sequence(seq_len);
+    for(size_t i = 0; i < seq_len; ++i)
+        rotated_sequence[i] = rx_sequence[(acc_start + i) % seq_len];
+
+    //Values of r for every element of the rotated sequence
+    rx_values_t<T, period> seq_rx{};
+    if constexpr (period == 0)
+        seq_rx.resize(seq_len);
+
+    //Continue the orbits of a previous render
+    const bool extend_orbits = orbits != nullptr && rsettings.extend_orbits;
+
+    //Iterations performed on the pixels of the block and statistics of their exponents
+    blockstats_t block_stats;
+
+    //Iterate over all the pixels in the block
+    for(size_t y = start_y; y < end_y; ++y){
+        for(size_t x = start_x; x < end_x; ++x){
+            //Initialize r for iteration A and r for interation B
+            const T ra = fp_lerp<T>(fsettings.min_ra, fsettings.max_ra, static_cast<T>(img_height - 1 - y) / static_cast<T>(img_height  - 1));
+            const T rb = fp_lerp<T>(fsettings.min_rb, fsettings.max_rb, static_cast<T>(x) / static_cast<T>(img_width - 1));
+
+            for(size_t i = 0; i < seq_len; ++i)
+                seq_rx[i] = (rotated_sequence[i] == rxtype::B) ? rb : ra;
+
+            //Initialize xn, n-th element of the sequence to the initial value
+            T xn = static_cast<T>(fsettings.x0.real());
+
+            //Initialize accumulator for Lyapunov exponent
+            T lyap_exp = 0;
+
+            //Initialize running product of the derivatives and its binary exponent,
+            //and the sum accumulated before it by a previous render
+            //(only used in accumulation_mode::product)
+            T der_prod = 1;
+            long long der_prod_exp = 0;
+            T prev_sum = 0;
+
+            size_t iter_count = 0;
+
+            //Continue from the saved state of the orbit. Finished orbits keep their exponent
+            if(extend_orbits){
+                const orbit_state_t& state = (*orbits)[y][x];
+                if(state.finished){
+                    lyap_exp_matr.set(y, x, state.log_sum);
+                    block_stats.add(0, lyap_exp_matr.get(y, x));
+                    continue;
+                }
+
+                xn = static_cast<T>(state.xn.real());
+                iter_count = state.iter_count;
+                if constexpr (acc_mode == accumulation_mode::product)
+                    prev_sum = static_cast<T>(state.log_sum);
+                else
+                    lyap_exp = static_cast<T>(state.log_sum);
+            }
+            const size_t start_iter = iter_count;
+
+            //Update the value of xn and of the Lyapunov exponent.
+            //Returns false once the exponent can't change anymore
+            const auto accumulating_step = [&](const T& selected_rx) -> bool {
+                xn        = (*map_fn)(xn, selected_rx);
+                if constexpr (acc_mode == accumulation_mode::product){
+                    der_prod *= fp_abs((*map_der_fn)(xn, selected_rx));
+
+                    //Pull out the exponent before the product can over/underflow
+                    if(!(der_prod >= renorm_lower_bound && der_prod <= renorm_upper_bound)){
+                        if(der_prod == 0 || !fp_isfinite(der_prod))
+                            return false;
+
+                        int e;
+                        der_prod = fp_frexp(der_prod, e);
+                        der_prod_exp += e;
+                    }
+                    return true;
+                }
+                else{
+                    lyap_exp += fp_log(fp_abs((*map_der_fn)(xn, selected_rx)));
+                    return fp_isfinite(lyap_exp);
+                }
+            };
+
+            //Sum of the logarithms of the derivatives accumulated so far
+            const auto accumulated_sum = [&]() -> T {
+                if constexpr (acc_mode == accumulation_mode::product)
+                    return prev_sum + (static_cast<T>(der_prod_exp) * ln2 + fp_log(der_prod));
+                else
+                    return lyap_exp;
+            };
+
+            //Transient iterations, which only update xn
+            for(size_t phase = (iter_count % seq_len + seq_len - acc_start % seq_len) % seq_len; iter_count < acc_start; ++iter_count){
+                xn = (*map_fn)(xn, seq_rx[phase]);
+                if(++phase == seq_len)
+                    phase = 0;
+            }
+
+            //Complete the period of the sequence interrupted at the end of the previous render
+            bool running = true;
+            for(size_t i = (iter_count - acc_start) % seq_len; i != 0 && i < seq_len && running && iter_count < max_iter; ++i, ++iter_count)
+                running = accumulating_step(seq_rx[i]);
+
+            //State of Brent's cycle detection, run on the orbit sampled at the end of every period of the sequence:
+            //the sample compared against, the sum of the logarithms when it was taken, and the periods since then.
+            //When extending a render, the detection starts over from the current state of the orbit
+            T cycle_x = xn;
+            T cycle_sum = accumulated_sum();
+            size_t cycle_len = 0;
+            size_t cycle_power = 1;
+
+            //Estimate of the exponent at the last convergence check and periods since then
+            T last_estimate = fp_infinity<T>();
+            size_t periods_since_check = 0;
+
+            //Set when the orbit has been classified or has converged, with the exponent (times avg_count) in resolved_exp
+            bool resolved = false;
+            T resolved_exp = 0;
+
+            //Full periods of the sequence
+            while(running && iter_count + seq_len <= max_iter){
+                #pragma GCC unroll 16
+                for(size_t i = 0; i < seq_len; ++i){
+                    if(!accumulating_step(seq_rx[i])){
+                        running = false;
+                        break;
+                    }
+                }
+                iter_count += seq_len;
+
+                if(running && detect_cycles){
+                    //Divergent orbit, its exponent would reach +inf anyway
+                    if(fp_abs(xn) > divergence_bound){
+                        resolved_exp = fp_infinity<T>();
+                        resolved = true;
+                        running = false;
+                        break;
+                    }
+
+                    //Periodic orbit, its exponent is the average over one cycle
+                    ++cycle_len;
+                    if(fp_abs(xn - cycle_x) <= cycle_tol){
+                        resolved_exp = (accumulated_sum() - cycle_sum) * avg_count / static_cast<T>(cycle_len * seq_len);
+                        resolved = true;
+                        running = false;
+                        break;
+                    }
+
+                    //Move the sample forward every power of 2 periods
+                    if(cycle_len == cycle_power){
+                        cycle_x = xn;
+                        cycle_sum = accumulated_sum();
+                        cycle_power *= 2;
+                        cycle_len = 0;
+                    }
+                }
+
+                if(running && detect_convergence && ++periods_since_check == conv_check_periods){
+                    periods_since_check = 0;
+
+                    const T estimate = accumulated_sum() / static_cast<T>(iter_count - acc_start);
+                    if(fp_abs(estimate - last_estimate) < conv_tol){
+                        resolved_exp = estimate * avg_count;
+                        resolved = true;
+                        running = false;
+                        break;
+                    }
+                    last_estimate = estimate;
+                }
+            }
+
+            //Last, incomplete, period of the sequence
+            for(size_t i = 0; running && iter_count < max_iter; ++i, ++iter_count)
+                running = accumulating_step(seq_rx[i]);
+
+            if(resolved)
+                lyap_exp = resolved_exp;
+            else
+                lyap_exp = accumulated_sum();
+            const T log_sum = lyap_exp;
+
+            //Take average
+            lyap_exp /= avg_count;
+
+            lyap_exp_matr.set(y, x, static_cast<long double>(lyap_exp));
+            block_stats.add(iter_count - start_iter, lyap_exp_matr.get(y, x));
+
+            //Save the state of the orbit. Orbits which stopped early, or have been classified or have converged, are final
+            if(orbits != nullptr){
+                (*orbits)[y][x] = orbit_state_t{std::complex<long double>(static_cast<long double>(xn), 0),
+                                                static_cast<long double>(running ? log_sum : lyap_exp),
+                                                iter_count, !running};
+            }
         }
     }
+
+    return block_stats;
+}
+
+#if ALYR_SIMD_BYTES > 0
+//Block renderer, vectorized over the pixels of a row for a real x0
+//Pixels on the same row share ra and follow the same sequence, so simd_vec<T>::lanes of them are iterated
+//together. Lanes whose exponent becomes non-finite are frozen, like the scalar kernel would stop iterating them.
+//period has the same meaning as in block_exp_calculator_real
+template<typename T, accumulation_mode acc_mode, size_t period, real_map_fn_ptr_t<simd_vec<T>> map_fn, real_map_der_fn_ptr_t<simd_vec<T>> map_der_fn>
+blockstats_t alyr::internals::block_exp_calculator_simd(const size_t& img_width, const size_t& img_height,
+                                                const size_t& start_x, const size_t& start_y,
+                                                const size_t& end_x, const size_t& end_y,
+                                                const size_t& max_iter,
+                                                lyap_exp_matrix_t& lyap_exp_matr,
+                                                orbit_matrix_t* orbits){
+    using vec_t  = simd_vec<T>;
+    using mask_t = typename vec_t::native_mask_t;
+    constexpr size_t lanes = vec_t::lanes;
+
+    //Auxiliary variables
+    const T ln2 = std::log(T{2});
+    const T renorm_upper_bound = fp_half_range_bound<T>();
+    const T renorm_lower_bound = T{1} / renorm_upper_bound;
+
+    //Number of iterations a pixel which stays finite is averaged on
+    const T avg_count = static_cast<T>((max_iter > rsettings.transient_iter) ?
+                                       max_iter - rsettings.transient_iter :
+                                       max_iter);
+
+    //Orbit classification, disabled if the tolerance is 0.
+    //Orbits going past divergence_bound are considered divergent
+    const bool detect_cycles = rsettings.cycle_tolerance > 0;
+    const T cycle_tol = static_cast<T>(rsettings.cycle_tolerance);
+    const T divergence_bound = static_cast<T>(1e10l);
+
+    //Early exit once the running estimate of the exponent changes by less than the tolerance
+    //between two checks, done every conv_check_periods periods of the sequence. Disabled if the tolerance is 0
+    const bool detect_convergence = rsettings.convergence_tolerance > 0;
+    const T conv_tol = static_cast<T>(rsettings.convergence_tolerance);
+
+    //Length of the sequence and first iteration contributing to the exponent
+    const size_t seq_len   = (period == 0) ? rx_sequence.size() : period;
+    const size_t acc_start = std::min(rsettings.transient_iter + 1, max_iter);
+    const size_t conv_check_periods = std::max<size_t>(1, (rsettings.convergence_interval + seq_len - 1) / seq_len);
+
+    //Sequence rotated so that it starts from the element used in iteration acc_start
+    std::vector<rxtype> rotated_sequence(seq_len);
+    for(size_t i = 0; i < seq_len; ++i)
+        rotated_sequence[i] = rx_sequence[(acc_start + i) % seq_len];
+
+    //Values of r for every element of the rotated sequence
+    rx_values_t<vec_t, period> seq_rx{};
+    if constexpr (period == 0)
+        seq_rx.resize(seq_len);
+
+    //Continue the orbits of a previous render
+    const bool extend_orbits = orbits != nullptr && rsettings.extend_orbits;
+
+    //Iterations performed on the pixels of the block and statistics of their exponents
+    blockstats_t block_stats;
+
+    //Iterate over all the pixels in the block, one group of lanes at a time
+    for(size_t y = start_y; y < end_y; ++y){
+        //Initialize r for iteration A, shared by the whole row
+        const vec_t ra = fp_lerp<T>(fsettings.min_ra, fsettings.max_ra, static_cast<T>(img_height - 1 - y) / static_cast<T>(img_height  - 1));
+
+        for(size_t x = start_x; x < end_x; x += lanes){
+            //Initialize r for iteration B. Lanes past the end of the block repeat the last pixel
+            vec_t rb;
+            for(size_t l = 0; l < lanes; ++l)
+                rb[l] = fp_lerp<T>(fsettings.min_rb, fsettings.max_rb, static_cast<T>(std::min(x + l, end_x - 1)) / static_cast<T>(img_width - 1));
+
+            for(size_t i = 0; i < seq_len; ++i)
+                seq_rx[i] = (rotated_sequence[i] == rxtype::B) ? rb : ra;
+
+            //Initialize xn, n-th element of the sequence to the initial value
+            vec_t xn = static_cast<T>(fsettings.x0.real());
+
+            //Initialize accumulator for Lyapunov exponent
+            vec_t lyap_exp = T{0};
+
+            //Initialize running product of the derivatives and its binary exponent,
+            //and the sum accumulated before it by a previous render
+            //(only used in accumulation_mode::product)
+            vec_t der_prod = T{1};
+            mask_t der_prod_exp = {};
+            vec_t prev_sum = T{0};
+
+            //Lanes still being iterated
+            mask_t active = ra.v == ra.v;
+
+            size_t iter_count = 0;
+
+            //Continue from the saved states of the orbits. Finished orbits keep their exponent and aren't iterated,
+            //all the others have been iterated up to the same max_iter
+            mask_t finished = {};
+            vec_t finished_exp = T{0};
+            if(extend_orbits){
+                for(size_t l = 0; l < lanes; ++l){
+                    const orbit_state_t& state = (*orbits)[y][std::min(x + l, end_x - 1)];
+                    if(state.finished){
+                        finished[l] = -1;
+                        finished_exp[l] = static_cast<T>(state.log_sum);
+                        continue;
+                    }
+
+                    xn[l] = static_cast<T>(state.xn.real());
+                    iter_count = state.iter_count;
+                    if constexpr (acc_mode == accumulation_mode::product)
+                        prev_sum[l] = static_cast<T>(state.log_sum);
+                    else
+                        lyap_exp[l] = static_cast<T>(state.log_sum);
+                }
+                active &= ~finished;
+            }
+            const size_t start_iter = iter_count;
+
+            //Update the value of xn and of the Lyapunov exponent.
+            //Returns false once the exponents of all the lanes can't change anymore
+            const auto accumulating_step = [&](const vec_t& selected_rx) -> bool {
+                xn        = (*map_fn)(xn, selected_rx);
+                if constexpr (acc_mode == accumulation_mode::product){
+                    der_prod = simd_select<T>(active, der_prod * simd_abs((*map_der_fn)(xn, selected_rx)), der_prod);
+
+                    //Pull out the exponents before the products can over/underflow
+                    const mask_t out_of_range = ~((der_prod.v >= renorm_lower_bound) & (der_prod.v <= renorm_upper_bound));
+                    if(simd_any(out_of_range & active)){
+                        //Lanes reaching 0, infinities or nan are final
+                        active &= simd_isfinite(der_prod) & (der_prod.v != 0);
+
+                        mask_t e;
+                        der_prod = simd_frexp(der_prod, e);
+                        der_prod_exp += e;
+
+                        return simd_any(active);
+                    }
+                    return true;
+                }
+                else{
+                    const vec_t updated_exp = lyap_exp + simd_log(simd_abs((*map_der_fn)(xn, selected_rx)));
+                    lyap_exp = simd_select<T>(active, updated_exp, lyap_exp);
+                    active &= simd_isfinite(updated_exp);
+
+                    return simd_any(active);
+                }
+            };
+
+            //Sum of the logarithms of the derivatives accumulated so far
+            const auto accumulated_sum = [&]() -> vec_t {
+                if constexpr (acc_mode == accumulation_mode::product)
+                    return prev_sum + (vec_t(__builtin_convertvector(der_prod_exp, typename vec_t::native_t)) * ln2 + simd_log(der_prod));
+                else
+                    return lyap_exp;
+            };
+
+            //Every lane has finished already
+            if(!simd_any(active)){
+                for(size_t l = 0; l < lanes && x + l < end_x; ++l){
+                    lyap_exp_matr.set(y, x + l, static_cast<long double>(finished_exp[l]));
+                    block_stats.add(0, lyap_exp_matr.get(y, x + l));
+                }
+                continue;
+            }
+
+            //Transient iterations, which only update xn
+            for(size_t phase = (iter_count % seq_len + seq_len - acc_start % seq_len) % seq_len; iter_count < acc_start; ++iter_count){
+                xn = (*map_fn)(xn, seq_rx[phase]);
+                if(++phase == seq_len)
+                    phase = 0;
+            }
+
+            //Iterations performed on every lane, recorded at the end of the period in which the lane stopped
+            std::array<size_t, lanes> lane_iters;
+            lane_iters.fill(max_iter);
+            mask_t recorded_active = active;
+            const auto record_stopped_lanes = [&](){
+                const mask_t stopped = recorded_active & ~active;
+                if(simd_any(stopped)){
+                    for(size_t l = 0; l < lanes; ++l)
+                        if(stopped[l])
+                            lane_iters[l] = iter_count;
+                    recorded_active = active;
+                }
+            };
+
+            //Complete the period of the sequence interrupted at the end of the previous render
+            bool running = true;
+            for(size_t i = (iter_count - acc_start) % seq_len; i != 0 && i < seq_len && running && iter_count < max_iter; ++i, ++iter_count)
+                running = accumulating_step(seq_rx[i]);
+            record_stopped_lanes();
+
+            //State of Brent's cycle detection, as in block_exp_calculator_real. The schedule is shared by all the lanes
+            vec_t cycle_x = xn;
+            vec_t cycle_sum = accumulated_sum();
+            size_t cycle_len = 0;
+            size_t cycle_power = 1;
+
+            //Estimates of the exponents at the last convergence check and periods since then
+            vec_t last_estimate = fp_infinity<T>();
+            size_t periods_since_check = 0;
+
+            //Lanes whose orbit has been classified or has converged, with their exponent (times avg_count) in resolved_exp
+            mask_t resolved = {};
+            vec_t resolved_exp = T{0};
+
+            //Full periods of the sequence
+            while(running && iter_count + seq_len <= max_iter){
+                #pragma GCC unroll 16
+                for(size_t i = 0; i < seq_len; ++i){
+                    if(!accumulating_step(seq_rx[i])){
+                        running = false;
+                        break;
+                    }
+                }
+                iter_count += seq_len;
+
+                if(running && detect_cycles){
+                    ++cycle_len;
+
+                    //Divergent orbits, whose exponent would reach +inf anyway,
+                    //and periodic orbits, whose exponent is the average over one cycle
+                    const mask_t divergent = active & (simd_abs(xn).v > divergence_bound);
+                    const mask_t periodic  = active & ~divergent & (simd_abs(xn - cycle_x).v <= cycle_tol);
+
+                    const bool sample_sum = (cycle_len == cycle_power);
+                    const vec_t current_sum = (sample_sum || simd_any(periodic)) ? accumulated_sum() : cycle_sum;
+
+                    if(simd_any(divergent | periodic)){
+                        resolved_exp = simd_select<T>(periodic, (current_sum - cycle_sum) * (avg_count / static_cast<T>(cycle_len * seq_len)), resolved_exp);
+                        resolved_exp = simd_select<T>(divergent, fp_infinity<T>(), resolved_exp);
+                        resolved |= divergent | periodic;
+                        active &= ~(divergent | periodic);
+
+                        if(!simd_any(active)){
+                            running = false;
+                            break;
+                        }
+                    }
+
+                    //Move the samples forward every power of 2 periods
+                    if(sample_sum){
+                        cycle_x = xn;
+                        cycle_sum = current_sum;
+                        cycle_power *= 2;
+                        cycle_len = 0;
+                    }
+                }
+
+                if(running && detect_convergence && ++periods_since_check == conv_check_periods){
+                    periods_since_check = 0;
+
+                    const vec_t estimate = accumulated_sum() / static_cast<T>(iter_count - acc_start);
+                    const mask_t converged = active & (simd_abs(estimate - last_estimate).v < conv_tol);
+                    if(simd_any(converged)){
+                        resolved_exp = simd_select<T>(converged, estimate * avg_count, resolved_exp);
+                        resolved |= converged;
+                        active &= ~converged;
+
+                        if(!simd_any(active)){
+                            running = false;
+                            break;
+                        }
+                    }
+                    last_estimate = estimate;
+                }
+
+                record_stopped_lanes();
+            }
+            record_stopped_lanes();
+
+            //Last, incomplete, period of the sequence
+            for(size_t i = 0; running && iter_count < max_iter; ++i, ++iter_count)
+                running = accumulating_step(seq_rx[i]);
+
+            const vec_t log_sum = accumulated_sum();
+            lyap_exp = simd_select<T>(resolved, resolved_exp, log_sum);
+
+            //Take average
+            lyap_exp = simd_select<T>(finished, finished_exp, lyap_exp / avg_count);
+
+            for(size_t l = 0; l < lanes && x + l < end_x; ++l){
+                lyap_exp_matr.set(y, x + l, static_cast<long double>(lyap_exp[l]));
+                block_stats.add(finished[l] ? 0 : lane_iters[l] - start_iter, lyap_exp_matr.get(y, x + l));
+
+                //Save the state of the orbit. Lanes not active anymore are final
+                if(orbits != nullptr && !finished[l]){
+                    (*orbits)[y][x + l] = orbit_state_t{std::complex<long double>(static_cast<long double>(xn[l]), 0),
+                                                        static_cast<long double>(active[l] ? log_sum[l] : lyap_exp[l]),
+                                                        lane_iters[l], !active[l]};
+                }
+            }
+        }
+    }
+
+    return block_stats;
 }
+#endif
 
-#endif
\ No newline at end of file
+#endif
@@ -1,89 +1,160 @@
 #include "alyr.hpp"
 
-//Renderer of a certain region
+//Color of a finite exponent in linear coloring, normalized in [0, 1], blending the two nearest colors of the palette
+static png::rgb_pixel linear_color(const long double& normalized_exp, const std::vector<png::rgb_pixel>& selected_pal){
+    assert(normalized_exp >= 0 && normalized_exp <= 1);
+
+    //Color selection
+    const long double fractional_color = normalized_exp * static_cast<long double>(selected_pal.size() - 1);
+
+    //Indexes of the color right after and right before the selected one,
+    //because (probably) fractional_color is not an integer
+    const size_t lower_color_id = size_t(floor(fractional_color));
+    const size_t upper_color_id = size_t( ceil(fractional_color)) % (selected_pal.size());
+    assert(lower_color_id <= upper_color_id);
+
+    //"Percentage", fraction in [0, 1], representing how much to take from every color for linear interpolation
+    const long double lower_color_fraction = fractional_color - static_cast<long double>(lower_color_id);
+    const long double upper_color_fraction = static_cast<long double>(upper_color_id) - fractional_color;
+
+    //Colors to blend
+    const png::rgb_pixel lower_color = selected_pal[lower_color_id];
+    const png::rgb_pixel upper_color = selected_pal[upper_color_id];
+
+    return png::rgb_pixel(
+        static_cast<long double>(lower_color.red)   * lower_color_fraction + static_cast<long double>(upper_color.red)   * upper_color_fraction,
+        static_cast<long double>(lower_color.green) * lower_color_fraction + static_cast<long double>(upper_color.green) * upper_color_fraction,
+        static_cast<long double>(lower_color.blue)  * lower_color_fraction + static_cast<long double>(upper_color.blue)  * upper_color_fraction
+    );
+}
+
+//Colors of a logarithmic table of size entries from the absolute value with bits min_bits, equalized on the histogram of
+//the absolute values of the exponents of a sign.
+//Each entry takes the color of the fraction of the exponents smaller than the one at its center,
+//normalized on the fraction of the ones smaller than max_abs (the biggest absolute value they can reach)
+static std::vector<png::rgb_pixel> histeq_colors(const std::array<uint64_t, expstats_t::hist_bins>& hist, const long double& max_abs,
+                                                 const uint32_t& min_bits, const size_t& size,
+                                                 const std::vector<png::rgb_pixel>& selected_pal){
+    constexpr size_t hist_bins = expstats_t::hist_bins;
+
+    //Cumulative histogram
+    std::vector<long double> cumulative(hist_bins + 1, 0);
+    for(size_t b = 0; b < hist_bins; ++b)
+        cumulative[b + 1] = cumulative[b] + static_cast<long double>(hist[b]);
+
+    //Number of exponents up to a position (in bins) in the histogram, interpolated inside the bins
+    const auto cdf = [&](const long double& hist_pos){
+        const long double pos = std::clamp(hist_pos, 0.0l, static_cast<long double>(hist_bins));
+        const size_t b = std::min(static_cast<size_t>(pos), hist_bins - 1);
+        return cumulative[b] + (pos - static_cast<long double>(b)) * static_cast<long double>(hist[b]);
+    };
+
+    const long double total = cdf((std::log10(max_abs) - expstats_t::hist_min_decade) * expstats_t::hist_bins_per_decade);
+
+    //The entries are indexed like in the lookup, so the logarithms are computed here once per entry
+    std::vector<png::rgb_pixel> colors(size);
+    for(size_t i = 0; i < size; ++i){
+        const uint32_t center_bits = min_bits + (static_cast<uint32_t>(i) << color_lut_t::log_shift) + (uint32_t(1) << (color_lut_t::log_shift - 1));
+        const long double hist_pos = (std::log10(static_cast<long double>(color_lut_t::from_bits(center_bits))) - expstats_t::hist_min_decade) *
+                                     expstats_t::hist_bins_per_decade;
+        const long double normalized_exp = (total > 0) ? std::min(cdf(hist_pos) / total, 1.0l) : 0;
+        colors[i] = linear_color(normalized_exp, selected_pal);
+    }
+
+    return colors;
+}
+
+//Build the lookup table of the colors of the exponents of a variant
+color_lut_t alyr::internals::build_color_lut(const recolor_variant_t& variant, const expstats_t& exp_stats){
+    color_lut_t lut;
+    lut.pos_color = variant.ppalette.back();
+    lut.neg_color = variant.npalette.back();
+
+    lut.lower_pos_clamp = static_cast<float>(variant.lower_pos_clamp);
+    lut.upper_pos_clamp = static_cast<float>(variant.upper_pos_clamp);
+    lut.lower_neg_clamp = static_cast<float>(variant.lower_neg_clamp);
+    lut.upper_neg_clamp = static_cast<float>(variant.upper_neg_clamp);
+    lut.pos_scale  = 0;
+    lut.pos_offset = 0;
+    lut.neg_scale  = 0;
+    lut.neg_offset = 0;
+    lut.logarithmic  = false;
+    lut.log_min_bits = 0;
+
+    //Without finite exponents of a sign, there's nothing to normalize for that sign
+    const long double max_pos = (exp_stats.pos_count != 0) ? exp_stats.max_pos : 0;
+    const long double min_neg = (exp_stats.neg_count != 0) ? exp_stats.min_neg : 0;
+
+    switch(variant.csettings.cmode){
+        //Binary coloring, every exponent takes the color of its sign
+        default:
+        case coloring_mode::binary:
+            break;
+
+        //Linear coloring
+        case coloring_mode::linear: {
+            //The clamped exponents are normalized to [0, 1] by the biggest absolute value they can reach
+            //(if all the exponents of a sign are 0, they're all mapped to the first entry)
+            const long double pos_exp_normalization_factor = std::min(max_pos, variant.upper_pos_clamp);
+            const long double neg_exp_normalization_factor = std::max(min_neg, variant.lower_neg_clamp);
+            const long double lut_size = static_cast<long double>(color_lut_t::lut_size);
+            if(pos_exp_normalization_factor != 0)
+                lut.pos_scale = static_cast<float>(lut_size / pos_exp_normalization_factor);
+            if(neg_exp_normalization_factor != 0)
+                lut.neg_scale = static_cast<float>(lut_size / neg_exp_normalization_factor);
+
+            //Every entry takes the color of the normalized exponent at its center
+            lut.pos_colors.resize(color_lut_t::lut_size);
+            lut.neg_colors.resize(color_lut_t::lut_size);
+            for(size_t i = 0; i < color_lut_t::lut_size; ++i){
+                const long double normalized_exp = (static_cast<long double>(i) + 0.5l) / lut_size;
+                lut.pos_colors[i] = linear_color(normalized_exp, variant.ppalette);
+                lut.neg_colors[i] = linear_color(normalized_exp, variant.npalette);
+            }
+        }   break;
+
+        //Histogram equalized coloring, every color of the palettes is taken by about as many exponents
+        case coloring_mode::histeq: {
+            //The tables cover the range of the histograms, logarithmically
+            const float min_abs = static_cast<float>(std::pow(10.0l, expstats_t::hist_min_decade));
+            const float max_abs = static_cast<float>(std::pow(10.0l, expstats_t::hist_max_decade));
+            const size_t size = color_lut_t::log_lut_size(min_abs, max_abs);
+            lut.logarithmic  = true;
+            lut.log_min_bits = color_lut_t::abs_bits(min_abs);
+
+            lut.pos_colors = histeq_colors(exp_stats.pos_hist,  std::min(max_pos, variant.upper_pos_clamp),
+                                           lut.log_min_bits, size, variant.ppalette);
+            lut.neg_colors = histeq_colors(exp_stats.neg_hist, -std::max(min_neg, variant.lower_neg_clamp),
+                                           lut.log_min_bits, size, variant.npalette);
+        }   break;
+    }
+
+    return lut;
+}
+
+//Renderer of a certain region, in all the images at once.
+//The exponents of each row of the region are converted from the storage type once, and then looked up
+//in every table while they're still in cache
 void alyr::internals::block_renderer(const size_t& start_x,      const size_t& start_y,
                                      const size_t& end_x,        const size_t& end_y,
-                                     const long double& max_pos, const long double& min_neg,
-                                     std::vector<std::vector<long double>>& lyap_exp_matr,
-                                     png::image<png::rgb_pixel>& img_to_color)
+                                     const std::vector<color_lut_t>& luts,
+                                     const lyap_exp_matrix_t& lyap_exp_matr,
+                                     std::vector<png::image<png::rgb_pixel>>& imgs_to_color)
 {
-    //Iterate over all the pixels in the block
-    for(size_t x = start_x; x < end_x; ++x){
-        for(size_t y = start_y; y < end_y; ++y){
-            //std::cout << "Computing for " << lyap_exp_matr[y][x] << std::endl;
-            png::rgb_pixel current_pixel;
-
-            switch(csettings.cmode){
-                //Binary coloring
-                default:
-                case coloring_mode::binary:
-                    if(lyap_exp_matr[y][x] >= 0)
-                        current_pixel = ppalette.back();
-                    else
-                        current_pixel = npalette.back();
-                    break;
-
-                //Linear coloring
-                case coloring_mode::linear: {
-                    //Sign of the exponent
-                    //1 -> negative
-                    //0 -> positive
-                    const bool exp_sign = (lyap_exp_matr[y][x] < 0);
-
-                    //Filter out infinities
-                    if(!std::isfinite(lyap_exp_matr[y][x])){
-                        if(lyap_exp_matr[y][x] >= 0)
-                            current_pixel = ppalette.back();
-                        else
-                            current_pixel = npalette.back();
-                        break;
-                    }
-
-                    //Normalize and clamp exponent to [0, 1]
-                    const long double pos_exp_normalization_factor = std::min(max_pos, rsettings.upper_pos_clamp);
-                    const long double neg_exp_normalization_factor = std::max(min_neg, rsettings.lower_neg_clamp);
-                    const long double clamped_current_lyap_exp =
-                        ((exp_sign == 0) ?
-                            std::clamp(lyap_exp_matr[y][x], rsettings.lower_pos_clamp, rsettings.upper_pos_clamp) :
-                            std::clamp(lyap_exp_matr[y][x], rsettings.lower_neg_clamp, rsettings.upper_neg_clamp)
-                        );
-                    const long double normalized_exp =
-                        ((exp_sign == 0) ?
-                            clamped_current_lyap_exp / pos_exp_normalization_factor :
-                            clamped_current_lyap_exp / neg_exp_normalization_factor
-                        );
-                    assert(normalized_exp >= 0 && normalized_exp <= 1);
-
-                    //Select palette based on the sign of the exponent
-                    const auto& selected_pal = ((exp_sign == 0) ? ppalette : npalette);
-
-                    //Color selection
-                    const long double fractional_color = normalized_exp * static_cast<long double>(selected_pal.size() - 1);
-
-                    //Indexes of the color right after and right before the selected one,
-                    //because (probably) fractional_color is not an integer
-                    const size_t lower_color_id = size_t(floor(fractional_color));
-                    const size_t upper_color_id = size_t( ceil(fractional_color)) % (selected_pal.size());
-                    assert(lower_color_id <= upper_color_id);
-
-                    //"Percentage", fraction in [0, 1], representing how much to take from every color for linear interpolation
-                    const long double lower_color_fraction = fractional_color - static_cast<long double>(lower_color_id);
-                    const long double upper_color_fraction = static_cast<long double>(upper_color_id) - fractional_color;
-
-                    //Colors to blend
-                    const png::rgb_pixel lower_color = selected_pal[lower_color_id];
-                    const png::rgb_pixel upper_color = selected_pal[upper_color_id];
-
-                    current_pixel = png::rgb_pixel(
-                        static_cast<long double>(lower_color.red)   * lower_color_fraction + static_cast<long double>(upper_color.red)   * upper_color_fraction,
-                        static_cast<long double>(lower_color.green) * lower_color_fraction + static_cast<long double>(upper_color.green) * upper_color_fraction,
-                        static_cast<long double>(lower_color.blue)  * lower_color_fraction + static_cast<long double>(upper_color.blue)  * upper_color_fraction
-                    );
-                }   break;
-            }
+    std::vector<float> row_exps(end_x - start_x);
+
+    //Iterate over all the rows in the block
+    for(size_t y = start_y; y < end_y; ++y){
+        //Exponents of the row, converted from the storage type to the type of the lookup
+        for(size_t x = start_x; x < end_x; ++x)
+            row_exps[x - start_x] = static_cast<float>(lyap_exp_matr.get(y, x));
 
-            //Actually color the image
-            img_to_color[y][x] = current_pixel;
+        //Actually color the images
+        for(size_t i = 0; i < luts.size(); ++i){
+            const color_lut_t& lut = luts[i];
+            auto& img_row = imgs_to_color[i][y];
+            for(size_t x = start_x; x < end_x; ++x)
+                img_row[x] = lut.color(row_exps[x - start_x]);
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,72 @@
+#include "alyr.hpp"
+
+#include <cstdio>
+#include <limits>
+
+using namespace std;
+using namespace alyr::internals;
+
+//Maximum side of the previews
+static constexpr size_t preview_max_side = 512;
+
+//Distance between the pixels of the image sampled by the preview
+static size_t preview_step(){
+    return max<size_t>(1, (max(isettings.image_width, isettings.image_height) + preview_max_side - 1) / preview_max_side);
+}
+
+//Part of the render each pixel of the preview is sampled from
+vector<size_t> alyr::internals::preview_pixel_parts(const vector<array<size_t, 4>>& parts, size_t& preview_width, size_t& preview_height){
+    const size_t step = preview_step();
+    preview_width  = (isettings.image_width  + step - 1) / step;
+    preview_height = (isettings.image_height + step - 1) / step;
+
+    vector<size_t> pixel_parts(preview_width * preview_height, preview_calculated);
+    for(size_t p = 0; p < parts.size(); ++p){
+        const auto [start_x, start_y, end_x, end_y] = parts[p];
+        for(size_t y = (start_y + step - 1) / step; y < (end_y + step - 1) / step; ++y)
+            for(size_t x = (start_x + step - 1) / step; x < (end_x + step - 1) / step; ++x)
+                pixel_parts[y * preview_width + x] = p;
+    }
+
+    return pixel_parts;
+}
+
+//Write the preview of the exponents of the parts completed so far
+int alyr::internals::save_preview(const lyap_exp_matrix_t& lyap_exp_matr,
+                                  const vector<size_t>& pixel_parts, const vector<atomic<bool>>& completed_parts,
+                                  const size_t& preview_width, const size_t& preview_height,
+                                  const string& filename){
+    const size_t step = preview_step();
+
+    //Exponents of the pixels of the preview already calculated (NaN for the others), and their statistics
+    vector<long double> exps(preview_width * preview_height, numeric_limits<long double>::quiet_NaN());
+    vector<bool> calculated(exps.size(), false);
+    expstats_t exp_stats;
+    for(size_t y = 0; y < preview_height; ++y){
+        for(size_t x = 0; x < preview_width; ++x){
+            const size_t i = y * preview_width + x;
+            if(pixel_parts[i] != preview_calculated && !completed_parts[pixel_parts[i]].load(memory_order_acquire))
+                continue;
+
+            exps[i] = lyap_exp_matr.get(y * step, x * step);
+            calculated[i] = true;
+            exp_stats.add(exps[i]);
+        }
+    }
+
+    //Colored like the image, the pixels not calculated yet are left black
+    recolor_variant_t variant = current_recolor_variant();
+    clamp_at_percentiles(exp_stats, variant.pos_clamp_percentile, variant.neg_clamp_percentile,
+                         variant.upper_pos_clamp, variant.lower_neg_clamp);
+    const color_lut_t lut = build_color_lut(variant, exp_stats);
+
+    png::image<png::rgb_pixel> preview(preview_width, preview_height);
+    for(size_t y = 0; y < preview_height; ++y)
+        for(size_t x = 0; x < preview_width; ++x)
+            if(calculated[y * preview_width + x])
+                preview[y][x] = lut.color(static_cast<float>(exps[y * preview_width + x]));
+
+    //Written to a temporary file and then renamed, so that the preview is never seen half written
+    preview.write(filename + ".tmp");
+    return (std::rename((filename + ".tmp").c_str(), filename.c_str()) == 0) ? 0 : 1;
+}
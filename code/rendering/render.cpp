@@ -1,13 +1,58 @@
 #include "alyr.hpp"
-#include "threadpool.hpp"
+#include "work_stealing_pool.hpp"
+#include "progress_reporter.hpp"
 
 #include <array>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <numeric>
 #define vcout if(consettings.verbose_output) cout
 
 using namespace std;
 using namespace alyr::internals;
 
+//Position of the cell (x, y) of an n x n grid (n power of 2) along the Hilbert curve covering it
+static uint64_t hilbert_index(const uint64_t& n, uint64_t x, uint64_t y){
+    uint64_t d = 0;
+    for(uint64_t s = n / 2; s > 0; s /= 2){
+        const uint64_t rx = (x & s) ? 1 : 0;
+        const uint64_t ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+
+        //Rotate the quadrant, so that the curve inside it starts and ends where it has to
+        if(ry == 0){
+            if(rx == 1){
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return d;
+}
+
+//Position of the cell (x, y) of a grid along the Morton (Z-order) curve covering it, interleaving the bits of x and y
+static uint64_t morton_index(const uint64_t& x, const uint64_t& y){
+    uint64_t d = 0;
+    for(size_t b = 0; b < 32; ++b)
+        d |= (((x >> b) & 1) << (2 * b)) | (((y >> b) & 1) << (2 * b + 1));
+    return d;
+}
+
+//Check that the image isn't divided into more sectors than the loops of the pool can run,
+//returns 0 if it isn't (otherwise the error is printed)
+static int check_sector_count(){
+    const size_t tiles_x = (isettings.image_width  + rsettings.max_sector_size - 1) / rsettings.max_sector_size;
+    const size_t tiles_y = (isettings.image_height + rsettings.max_sector_size - 1) / rsettings.max_sector_size;
+    if(tiles_y != 0 && tiles_x > work_stealing_pool_t::max_loop_size / tiles_y){
+        print_error("the image would be divided into too many sectors, use bigger sectors (--sector-size)");
+        return 1;
+    }
+    return 0;
+}
+
 //Function to subdivide the image in "sectors" to parallelize jobs
 //Implementation: render.cpp
 vector<array<size_t, 4>> alyr::internals::generate_sectors(){
@@ -28,11 +73,125 @@ vector<array<size_t, 4>> alyr::internals::generate_sectors(){
         }
     }
 
+    //Sort the sectors in the required order (the ties, and the row-major order, keep the order in which they've been created)
+    const size_t tiles_x = (isettings.image_width  + rsettings.max_sector_size - 1) / rsettings.max_sector_size;
+    const size_t tiles_y = (isettings.image_height + rsettings.max_sector_size - 1) / rsettings.max_sector_size;
+    size_t grid_side = 1;
+    while(grid_side < max(tiles_x, tiles_y))
+        grid_side *= 2;
+
+    const auto sector_key = [&](const array<size_t, 4>& s) -> uint64_t {
+        const uint64_t tile_x = s[0] / rsettings.max_sector_size;
+        const uint64_t tile_y = s[1] / rsettings.max_sector_size;
+        switch(rsettings.sectors_order){
+            case sector_order::morton:
+                return morton_index(tile_x, tile_y);
+            case sector_order::hilbert:
+                return hilbert_index(grid_side, tile_x, tile_y);
+            //Squared distance of the center of the sector from the center of the image (both doubled, to stay integers)
+            case sector_order::center_out: {
+                const int64_t dx = static_cast<int64_t>(s[0] + s[2]) - static_cast<int64_t>(isettings.image_width);
+                const int64_t dy = static_cast<int64_t>(s[1] + s[3]) - static_cast<int64_t>(isettings.image_height);
+                return static_cast<uint64_t>(dx * dx + dy * dy);
+            }
+            default:
+            case sector_order::row_major:
+                return 0;
+        }
+    };
+
+    vector<pair<uint64_t, array<size_t, 4>>> keyed_sectors;
+    for(const auto& s : sectors)
+        keyed_sectors.emplace_back(sector_key(s), s);
+    stable_sort(keyed_sectors.begin(), keyed_sectors.end(), [](const auto& a, const auto& b){return a.first < b.first;});
+    for(size_t i = 0; i < sectors.size(); ++i)
+        sectors[i] = keyed_sectors[i].second;
+
     return sectors;
 }
 
+//Statistics of the exponents of all the pixels in a certain region
+//Implementation: render.cpp
+expstats_t alyr::internals::block_exp_stats(const size_t& start_x, const size_t& start_y,
+                                            const size_t& end_x,   const size_t& end_y,
+                                            const lyap_exp_matrix_t& lyap_exp_matr){
+    expstats_t block_stats;
+    for(size_t y = start_y; y < end_y; ++y)
+        for(size_t x = start_x; x < end_x; ++x)
+            block_stats.add(lyap_exp_matr.get(y, x));
+
+    return block_stats;
+}
+
+//Move the clamps of the exponents to the required percentiles of their absolute values
+void alyr::internals::clamp_at_percentiles(const expstats_t& exp_stats, const long double& pos_percentile, const long double& neg_percentile,
+                                           long double& upper_pos_clamp, long double& lower_neg_clamp){
+    if(pos_percentile < 100 && exp_stats.pos_count != 0)
+        upper_pos_clamp = std::min(upper_pos_clamp, exp_stats.abs_percentile(false, pos_percentile));
+    if(neg_percentile < 100 && exp_stats.neg_count != 0)
+        lower_neg_clamp = std::max(lower_neg_clamp, -exp_stats.abs_percentile(true, neg_percentile));
+}
+
+//Estimate the cost of calculating the exponents of every sector on a probe, a render with 1/probe_step of the resolution
+//in each direction and 1/probe_step of the iterations after the transient, and split the heaviest sectors into strips of rows
+//with about the same cost, so that at the end of the render the workers don't wait for a few slow sectors.
+//Returns the parts to calculate and, in part_sectors, the index of the sector of each of them
+static vector<array<size_t, 4>> split_heavy_sectors(const vector<array<size_t, 4>>& sectors, const block_exp_calc_fn_ptr_t& block_exp_calc_pointer,
+                                                    work_stealing_pool_t& pool, vector<size_t>& part_sectors){
+    constexpr size_t probe_step = 8;
+    //Parts of about the same cost every worker should be able to take, the bigger the shorter the wait at the end
+    constexpr size_t parts_per_worker = 16;
+
+    const size_t probe_width  = (isettings.image_width  + probe_step - 1) / probe_step;
+    const size_t probe_height = (isettings.image_height + probe_step - 1) / probe_step;
+    const size_t probe_iter   = (rsettings.max_iter > rsettings.transient_iter) ?
+                                rsettings.transient_iter + max<size_t>(1, (rsettings.max_iter - rsettings.transient_iter) / probe_step) :
+                                rsettings.max_iter;
+
+    //First pixel of the probe at or after the pixel of the image at coord: the pixels of both span the whole
+    //fractal, the first at 0 and the last at its other end
+    const auto probe_coord = [](const size_t& coord, const size_t& img_size, const size_t& probe_size){
+        return min(probe_size, (coord * (probe_size - 1) + img_size - 2) / (img_size - 1));
+    };
+
+    //Cost of every sector, as the iterations performed on the pixels of the probe which fall inside it
+    vector<size_t> costs(sectors.size(), 0);
+    if(pool.num_workers() > 1 && probe_width > 1 && probe_height > 1){
+        lyap_exp_matrix_t probe(probe_height, probe_width, storage_type::long_double, 1);
+
+        pool.parallel_for(sectors.size(), [&](const size_t& i, const size_t&){
+            const auto [start_x, start_y, end_x, end_y] = sectors[i];
+            const size_t probe_start_x = probe_coord(start_x, isettings.image_width,  probe_width);
+            const size_t probe_start_y = probe_coord(start_y, isettings.image_height, probe_height);
+            const size_t probe_end_x   = probe_coord(end_x,   isettings.image_width,  probe_width);
+            const size_t probe_end_y   = probe_coord(end_y,   isettings.image_height, probe_height);
+            if(probe_start_x < probe_end_x && probe_start_y < probe_end_y)
+                costs[i] = block_exp_calc_pointer(probe_width, probe_height, probe_start_x, probe_start_y, probe_end_x, probe_end_y,
+                                                  probe_iter, probe, nullptr).iters.total_iter;
+        });
+    }
+
+    //Split the sectors costing more than the target into strips of rows
+    const size_t total_cost  = accumulate(costs.begin(), costs.end(), size_t(0));
+    const size_t target_cost = max<size_t>(1, total_cost / (pool.num_workers() * parts_per_worker));
+
+    vector<array<size_t, 4>> parts;
+    part_sectors.clear();
+    for(size_t i = 0; i < sectors.size(); ++i){
+        const auto [start_x, start_y, end_x, end_y] = sectors[i];
+        const size_t rows = end_y - start_y;
+        const size_t num_parts = clamp<size_t>((costs[i] + target_cost - 1) / target_cost, 1, rows);
+        for(size_t p = 0; p < num_parts; ++p){
+            parts.push_back({start_x, start_y + rows * p / num_parts, end_x, start_y + rows * (p + 1) / num_parts});
+            part_sectors.push_back(i);
+        }
+    }
+
+    return parts;
+}
+
 //--------------------------------------------------------------------------------------------------
-png::image<png::rgb_pixel> alyr::render(){
+int alyr::render(png::image<png::rgb_pixel>& fractal_image){
     // The render is divided into 3 steps
     // 1) generate the exponents matrix, either by performing calculations or loading it from a file
     // 2) save the matrix to a file
@@ -43,114 +202,395 @@ png::image<png::rgb_pixel> alyr::render(){
     // 
     // - allocate the matrix
     // - allocate a vector of block (sectors) into which the image is divided to parallelize the rendering job
-    // - create a threadpool and a vector of future<void> for the multithreading part
+    // - create a work stealing pool for the multithreading part, running the sectors as parallel-for loops
     // calculations
     // - generate sectors to parallelize the rendering job
     // - get pointer to exponent calculator function
     // - print info
-    // - enqueue jobs in threadpool
-    // - print completion state
+    // - estimate the cost of the sectors on a low resolution probe, and split the heaviest ones into parts
+    // - run the jobs in the pool, which also gather the statistics of the exponents (one copy per worker)
+    // - report the progress from its own thread (and write checkpoints and previews while waiting)
     // OR
     // load from file
     // - load matrix from file
     // - generate sectors
 
-    //Two-dimensional vector containing the Ly. exp for each calculated point
-    vector<vector<long double>> lyap_exponents;
+    //Matrix containing the Ly. exp for each calculated point
+    lyap_exp_matrix_t lyap_exponents;
     //Divide the image into block (sectors)
     vector<array<size_t, 4>> sectors;
 
-    //Create threadpool for parallel jobs
-    threadpool renderpool(rsettings.max_threads);
-    //Vector of future to wait for all the other threads to continue the rendering after all the jobs on all the sectors is finished
-    vector<future<void>> completed_sectors;
+    //Create pool for parallel jobs, with every thread on its own core if required
+    work_stealing_pool_t renderpool(rsettings.max_threads);
+    if(rsettings.pin_threads && renderpool.pin_workers() != 0)
+        print_warning("the rendering threads couldn't be pinned to the cores");
+    //Progress of the render reported on the console, if verbose, and as JSON lines to a file, if required
+    ostream* const progress_console = consettings.verbose_output ? &cout : nullptr;
+    const bool progress_console_live = stdout_is_terminal();
+    ofstream progress_json_file;
+    if(!consettings.progress_json_filename.empty()){
+        progress_json_file.open(consettings.progress_json_filename, ofstream::out | ofstream::app);
+        if(!progress_json_file.is_open())
+            print_warning("progress JSON file could not be opened, the progress won't be written to it");
+    }
+    ostream* const progress_json = progress_json_file.is_open() ? &progress_json_file : nullptr;
+    //Statistics of the exponents, gathered while calculating them, and the sectors which still need to be scanned for them
+    //(the sectors of a loaded matrix, or of a resumed render completed before the interruption)
+    expstats_t exp_stats;
+    vector<array<size_t, 4>> unscanned_sectors;
+    //Checkpoints need the partial matrix in the output file, so the file is mapped and can't be compressed
+    const bool checkpointing = !rsettings.load_exp_matrix && (rsettings.checkpoint_interval > 0 || rsettings.resume_render);
+    if(checkpointing){
+        if(!rsettings.save_exp_matrix || !ALYR_MMAP){
+            const char* reason = !rsettings.save_exp_matrix ? "checkpoints require saving the exponent matrix" :
+                                                              "checkpoints are not supported on this system";
+            if(rsettings.resume_render){
+                print_error(reason);
+                return 2;
+            }
+            print_warning(string(reason) + ", the render won't be checkpointed");
+            rsettings.checkpoint_interval = 0;
+        }
+        else{
+            if(rsettings.compression_level > 0){
+                print_warning("checkpointed exponent matrix files can't be compressed, the matrix will be saved uncompressed");
+                rsettings.compression_level = 0;
+            }
+            rsettings.map_exp_matrix = true;
+        }
+    }
+
+    //Tiles of the matrix compressed by the exponent calculation jobs, when saving a compressed file
+    //(the tiles are the sectors, in the same row-major order)
+    vector<compressed_tile_t> compressed_tiles;
+    const bool compress_tiles = rsettings.save_exp_matrix && rsettings.compression_level > 0;
+    //Tiles whose exponents have been calculated, set by the exponent calculation jobs when checkpointing
+    vector<atomic<bool>> completed_tiles;
+
+    //The orbit states are saved next to the exponent matrix file, and only hold the whole render when it isn't resumed
+    if(rsettings.save_orbits && !rsettings.load_exp_matrix && (!rsettings.save_exp_matrix || rsettings.resume_render)){
+        print_warning(!rsettings.save_exp_matrix ?
+                      "orbit states can be saved only when saving the exponent matrix, they won't be saved" :
+                      "orbit states of a resumed render are incomplete, they won't be saved");
+        rsettings.save_orbits = false;
+    }
+    if(rsettings.extend_orbits && rsettings.load_exp_matrix){
+        print_warning("orbits can't be extended when loading the exponent matrix, the option will be ignored");
+        rsettings.extend_orbits = false;
+    }
+    //States of the orbits of all the pixels, continued from a previous render and/or saved for a later one
+    orbit_matrix_t orbit_states;
 
     //If calculations are necessary...
     if(!rsettings.load_exp_matrix){
-        //Pre-allocate the matrix
-        vcout << "Allocating lambda matrix in RAM... " << flush;
-        lyap_exponents = vector<vector<long double>>(isettings.image_height, vector<long double>(isettings.image_width, 0));
-        vcout << "Done!" << endl;
+        if(check_sector_count() != 0)
+            return 2;
+
+        //Function pointer to Lyapunov exp calculator
+        //(selected first, as it can fall back to another floating point type, which is saved with the matrix)
+        block_exp_calc_fn_ptr_t block_exp_calc_pointer = get_block_exp_calc_ptr();
+
+        //Without mmap support, the matrix is allocated in RAM and saved at the end
+        if(rsettings.map_exp_matrix && (!rsettings.save_exp_matrix || !ALYR_MMAP || compress_tiles)){
+            print_warning(!rsettings.save_exp_matrix ?
+                          "the exponent matrix file can be mapped only when saving the matrix, the matrix will be allocated in RAM" :
+                          compress_tiles ?
+                          "compressed exponent matrix files can't be mapped, the matrix will be allocated in RAM" :
+                          "mapping the exponent matrix file is not supported on this system, the matrix will be allocated in RAM");
+            rsettings.map_exp_matrix = false;
+        }
+
+        //Matrices in RAM written by the workers are allocated without touching their pages, in huge pages if required
+        //(the pages of a mapped file are placed by the workers too, but can't be huge pages)
+        if(rsettings.huge_pages && (rsettings.resume_render || rsettings.map_exp_matrix))
+            print_warning("mapped exponent matrix files can't be backed by huge pages");
+        const matrix_alloc matrix_alloc_required = rsettings.huge_pages ? matrix_alloc::huge_pages : matrix_alloc::first_touch;
+
+        //Pre-allocate the matrix, in RAM or directly in the output file, or map the file of the render to resume
+        if(rsettings.resume_render){
+            vcout << "Mapping lambda matrix file to resume... " << flush;
+            lyap_exponents = open_mapped_lyap_exp_matrix(isettings.image_height, isettings.image_width,
+                                                         rsettings.exp_storage, rsettings.storage_scale,
+                                                         rsettings.lyap_exp_matr_out_filename);
+            if(lyap_exponents.empty()){
+                vcout << "ERROR" << endl;
+                return 2;
+            }
+        }
+        else if(rsettings.map_exp_matrix){
+            vcout << "Mapping lambda matrix file... " << flush;
+            lyap_exponents = create_mapped_lyap_exp_matrix(isettings.image_height, isettings.image_width,
+                                                           rsettings.exp_storage, rsettings.storage_scale,
+                                                           rsettings.lyap_exp_matr_out_filename);
+            if(lyap_exponents.empty()){
+                vcout << "ERROR" << endl;
+                return 2;
+            }
+        }
+        //The pages of the matrix in RAM are placed by the workers calculating their sectors, which write them first
+        else{
+            vcout << "Allocating lambda matrix in RAM... " << flush;
+            lyap_exponents = lyap_exp_matrix_t(isettings.image_height, isettings.image_width, rsettings.exp_storage, rsettings.storage_scale,
+                                               matrix_alloc_required);
+        }
+        vcout << (lyap_exponents.huge_pages() ? "Done! (huge pages)" : "Done!") << endl;
 
         //Generate the sectors
         sectors = generate_sectors();
+        const size_t num_tiles = lyap_exp_tile_count(isettings.image_height, isettings.image_width, rsettings.max_sector_size);
+        if(compress_tiles)
+            compressed_tiles.resize(num_tiles);
+
+        //Tiles already completed by the interrupted render, or none for a new one
+        vector<bool> checkpoint_tiles(num_tiles, false);
+        if(rsettings.resume_render){
+            if(load_checkpoint(rsettings.lyap_exp_matr_out_filename, rsettings.max_sector_size, num_tiles, checkpoint_tiles) != 0){
+                return 2;
+            }
+            vcout << "Resuming render: " << count(checkpoint_tiles.begin(), checkpoint_tiles.end(), true) << "/" << num_tiles
+                  << " sectors already completed" << endl;
+        }
+        else if(checkpointing && save_checkpoint(rsettings.lyap_exp_matr_out_filename, rsettings.max_sector_size, checkpoint_tiles) != 0){
+            print_warning("checkpoint file couldn't be written");
+        }
+        if(checkpointing){
+            completed_tiles = vector<atomic<bool>>(num_tiles);
+            for(size_t t = 0; t < num_tiles; ++t)
+                completed_tiles[t].store(checkpoint_tiles[t], memory_order_relaxed);
+        }
 
-        //Function pointer to Lyapunov exp calculator
-        block_exp_calc_fn_ptr_t block_exp_calc_pointer = get_block_exp_calc_ptr();
+        //Load the orbits to extend, or allocate their states to save them
+        if(rsettings.extend_orbits){
+            vcout << "Loading orbit states... " << flush;
+            orbit_states = load_orbit_states(rsettings.orbits_in_filename, matrix_alloc_required, renderpool, sectors);
+            if(orbit_states.empty()){
+                vcout << "ERROR" << endl;
+                return 2;
+            }
+            vcout << "Done!" << endl;
+        }
+        else if(rsettings.save_orbits)
+            orbit_states = orbit_matrix_t(isettings.image_height, isettings.image_width, matrix_alloc_required);
+        orbit_matrix_t* const orbits = orbit_states.empty() ? nullptr : &orbit_states;
 
         //Print info if required
         if(rsettings.load_exp_matrix == false &&  consettings.verbose_output == true)
             print_render_info();
 
-        //Enqueue jobs
-        //For every sector
+        //Row-major index of the tile of a sector
+        const auto tile_of = [](const array<size_t, 4>& s){
+            return (s[1] / rsettings.max_sector_size) * ((isettings.image_width + rsettings.max_sector_size - 1) / rsettings.max_sector_size) +
+                   s[0] / rsettings.max_sector_size;
+        };
+
+        //Sectors to calculate, the ones completed before the render has been interrupted are already in the file
+        vector<array<size_t, 4>> exp_sectors;
         for(auto s : sectors){
-            size_t start_x = s[0];
-            size_t start_y = s[1];
-            size_t end_x   = s[2];
-            size_t end_y   = s[3];
-
-            //Enqueue a job to the renderpool
-            completed_sectors.emplace_back(
-                renderpool.enqueue(
-                    block_exp_calc_pointer,     //Block exponent calculator
-                    isettings.image_width,      //Width of the image
-                    isettings.image_height,     //Height of the image
-                    start_x, start_y,           //(x,y) starting position
-                    end_x, end_y,               //(x,y) ending position
-                    ref(lyap_exponents)         //Reference to matrix of exponents
-                )
-            );
+            if(checkpointing && completed_tiles[tile_of(s)].load(memory_order_relaxed))
+                unscanned_sectors.push_back(s);
+            else
+                exp_sectors.push_back(s);
         }
 
+        //Parts of the sectors to calculate, the heaviest sectors split into strips of rows
+        //(the cost of the orbits to extend isn't known, as they start from where the previous render stopped)
+        vector<array<size_t, 4>> exp_parts;
+        vector<size_t> part_sectors;
+        if(rsettings.adaptive_sectors && !rsettings.extend_orbits){
+            vcout << "Estimating the cost of the sectors... " << flush;
+            exp_parts = split_heavy_sectors(exp_sectors, block_exp_calc_pointer, renderpool, part_sectors);
+            vcout << "Done! (" << exp_sectors.size() << " sectors in " << exp_parts.size() << " parts)" << endl;
+        }
+        else{
+            exp_parts = exp_sectors;
+            part_sectors.resize(exp_sectors.size());
+            iota(part_sectors.begin(), part_sectors.end(), size_t(0));
+        }
+        //Sectors ordered from the center outwards are dealt to the workers one at a time,
+        //so that every worker, which takes a contiguous run of parts, starts from the center
+        if(rsettings.sectors_order == sector_order::center_out){
+            const size_t num_workers = renderpool.num_workers();
+            vector<array<size_t, 4>> dealt_parts;
+            vector<size_t> dealt_part_sectors;
+            for(size_t w = 0; w < num_workers; ++w){
+                for(size_t i = w; i < exp_parts.size(); i += num_workers){
+                    dealt_parts.push_back(exp_parts[i]);
+                    dealt_part_sectors.push_back(part_sectors[i]);
+                }
+            }
+            exp_parts = move(dealt_parts);
+            part_sectors = move(dealt_part_sectors);
+        }
+
+        //Parts completed so far and pixels of the preview they're sampled from, if required to write previews
+        const bool write_previews = rsettings.preview_interval > 0;
+        vector<atomic<bool>> completed_parts(write_previews ? exp_parts.size() : 0);
+        size_t preview_width = 0, preview_height = 0;
+        vector<size_t> preview_parts;
+        if(write_previews)
+            preview_parts = preview_pixel_parts(exp_parts, preview_width, preview_height);
+
+        //Parts of every sector still to be calculated
+        vector<atomic<size_t>> sector_parts_left(exp_sectors.size());
+        for(const auto& s : part_sectors)
+            sector_parts_left[s].fetch_add(1, memory_order_relaxed);
+
+        //Progress of the calculation, counting the sectors completed before the render has been interrupted as done
+        size_t resumed_pixels = 0;
+        for(const auto& [start_x, start_y, end_x, end_y] : unscanned_sectors)
+            resumed_pixels += (end_x - start_x) * (end_y - start_y);
+        progress_reporter_t progress("exp", renderpool.num_workers(),
+                                     sectors.size(), isettings.image_width * isettings.image_height,
+                                     unscanned_sectors.size(), resumed_pixels,
+                                     progress_console, progress_console_live, progress_json);
+
+        //Number of iterations performed and statistics of the exponents, gathered separately by every worker
+        vector<blockstats_t> worker_stats(renderpool.num_workers());
+
+        //Job of a part: calculate its exponents. The thread completing the last part of a sector then,
+        //right after, while it's still in its cache, compresses the sector or marks it as completed for the next checkpoint
+        const auto calc_part = [&](const size_t& i, const size_t& worker){
+            progress.begin_work(worker);
+
+            const auto [start_x, start_y, end_x, end_y] = exp_parts[i];
+            const blockstats_t part_stats = block_exp_calc_pointer(isettings.image_width, isettings.image_height,
+                                                                   start_x, start_y, end_x, end_y, rsettings.max_iter,
+                                                                   lyap_exponents, orbits);
+            worker_stats[worker].merge(part_stats);
+
+            const bool sector_completed = (sector_parts_left[part_sectors[i]].fetch_sub(1, memory_order_acq_rel) == 1);
+            if(sector_completed){
+                const auto& s = exp_sectors[part_sectors[i]];
+                if(compress_tiles)
+                    compressed_tiles[tile_of(s)] = compress_lyap_exp_tile(lyap_exponents, s[0], s[1], s[2], s[3], rsettings.compression_level);
+                if(checkpointing)
+                    completed_tiles[tile_of(s)].store(true, memory_order_release);
+            }
+            if(write_previews)
+                completed_parts[i].store(true, memory_order_release);
+
+            progress.end_work(worker, sector_completed ? 1 : 0, (end_x - start_x) * (end_y - start_y), part_stats.iters.total_iter);
+        };
+        renderpool.start(exp_parts.size(), calc_part);
+
+        //Write a checkpoint of the tiles completed so far.
+        //The flags are read before writing the matrix to the disk, so that every tile in the checkpoint is already there
+        const auto write_checkpoint = [&](){
+            vector<bool> snapshot(completed_tiles.size());
+            for(size_t t = 0; t < completed_tiles.size(); ++t)
+                snapshot[t] = completed_tiles[t].load(memory_order_acquire);
+
+            if(lyap_exponents.mapped_file()->sync() != 0 ||
+               save_checkpoint(rsettings.lyap_exp_matr_out_filename, rsettings.max_sector_size, snapshot) != 0)
+                print_warning("checkpoint file couldn't be written");
+        };
+
+        //Wait for all the jobs to finish, while the progress is reported by its own thread
+        //(writing a checkpoint every checkpoint_interval seconds and a preview every preview_interval seconds while waiting)
+        auto next_checkpoint = chrono::steady_clock::now() + chrono::seconds(rsettings.checkpoint_interval);
+        auto next_preview = chrono::steady_clock::now() + chrono::seconds(rsettings.preview_interval);
+        while(rsettings.checkpoint_interval > 0 || write_previews){
+            auto deadline = (rsettings.checkpoint_interval > 0) ? next_checkpoint : next_preview;
+            if(write_previews)
+                deadline = min(deadline, next_preview);
+            if(renderpool.wait_until(deadline))
+                break;
+
+            if(rsettings.checkpoint_interval > 0 && chrono::steady_clock::now() >= next_checkpoint){
+                write_checkpoint();
+                next_checkpoint = chrono::steady_clock::now() + chrono::seconds(rsettings.checkpoint_interval);
+            }
+            if(write_previews && chrono::steady_clock::now() >= next_preview){
+                if(save_preview(lyap_exponents, preview_parts, completed_parts, preview_width, preview_height,
+                                isettings.image_name + "_preview.png") != 0)
+                    print_warning("couldn't write the preview of the render");
+                next_preview = chrono::steady_clock::now() + chrono::seconds(rsettings.preview_interval);
+            }
+        }
+        renderpool.wait();
+        progress.finish();
+
+        //Gather the number of iterations performed and the statistics of the exponents of all the workers
+        iterstats_t total_iters;
+        for(const auto& stats : worker_stats){
+            total_iters.merge(stats.iters);
+            exp_stats.merge(stats.exps);
+        }
 
-        //Print completion state
-        const size_t total_sectors = sectors.size();
-        vcout << "Completed sectors (exp): 0/" << total_sectors << "\r" << flush;
-        //Once all the jobs are enqueued, wait for all of them to finish
-        for(size_t i = 0; i < completed_sectors.size(); ++i){
-            completed_sectors[i].get();
-            vcout << "Completed sectors (exp): " << i << "/" << total_sectors << "\r" << flush;
+        //Print the number of iterations performed per pixel
+        if(total_iters.pixels != 0){
+            vcout << "Iterations per pixel: min " << total_iters.min_iter
+                  << ", avg " << static_cast<long double>(total_iters.total_iter) / static_cast<long double>(total_iters.pixels)
+                  << ", max " << total_iters.max_iter
+                  << " (total " << total_iters.total_iter << ")" << endl;
         }
-        vcout << "Completed sectors (exp): " << total_sectors << "/" << total_sectors << endl;
-        completed_sectors.clear();
     }
     //If matrix is loaded from file...
     else{
         //Load data from file
-        vcout << "Loading lambda matrix in RAM... " << flush;
-        lyap_exponents = load_lyap_exp_matrix(rsettings.lyap_exp_matr_in_filename);
-        vcout << "Done!" << endl;
+        vcout << "Loading lambda matrix... " << flush;
+        lyap_exponents = load_lyap_exp_matrix(rsettings.lyap_exp_matr_in_filename, renderpool);
+        vcout << (lyap_exponents.is_mapped() ? "Done! (mapped)" : "Done!") << endl;
 
         //Check for validity of data
-        if(lyap_exponents == vector<vector<long double>>{vector<long double>{}}){
+        if(lyap_exponents.empty()){
             print_error("invalid exponent matrix loaded from file");
-            //Return 1x1 empty image
-            return png::image<png::rgb_pixel>(1, 1);
+            return 2;
         }
 
         //Update the image settings accordingly
-        isettings.image_height = lyap_exponents.size();             //Number of rows
-        isettings.image_width  = lyap_exponents.front().size();     //Number of columns
+        isettings.image_height = lyap_exponents.rows();     //Number of rows
+        isettings.image_width  = lyap_exponents.cols();     //Number of columns
 
         //Generate the sectors with the new settings
+        if(check_sector_count() != 0)
+            return 2;
         sectors = generate_sectors();
+        unscanned_sectors = sectors;
     }
 
     //----------------------
     // STEP 2: save the matrix to a file (if required)
     // 
     // - if required to save, continue, else go to step 3
-    // - save the matrix to a file
-    // - reload it to RAM
-    // - check if what has been saved is identical to the initial matrix
-
-    if(rsettings.save_exp_matrix){
-        vcout << "Saving... " << flush;
-        if(save_lyap_exp_matrix(lyap_exponents, rsettings.lyap_exp_matr_out_filename) == 0){
+    // - if the matrix is mapped to the file, write the checksums and the changes to the disk, remove the checkpoint
+    //   (if any) and go to step 3
+    // - if the matrix has been loaded from the same file, go to step 3
+    // - save the matrix to a file, together with the checksums of the exponents
+    //   (if compressed, the tiles not already compressed by the exponent calculation jobs are compressed now)
+    // - read the file back one chunk at a time and check it against the checksums
+    // - save the states of the orbits (if required)
+
+    if(rsettings.save_exp_matrix && !rsettings.load_exp_matrix && rsettings.map_exp_matrix){
+        vcout << "Syncing... " << flush;
+        if(sync_mapped_lyap_exp_matrix(lyap_exponents) == 0){
+            vcout << "OK" << endl;
+            //The render is complete, the checkpoint isn't needed anymore
+            if(checkpointing)
+                remove_checkpoint(rsettings.lyap_exp_matr_out_filename);
+        }
+        else{
+            vcout << "ERROR" << endl;
+            print_warning("exponent matrix file couldn't be written to disk");
+        }
+    }
+    //The loaded matrix can be mapped to the input file, which must not be overwritten while in use
+    else if(rsettings.save_exp_matrix && rsettings.load_exp_matrix &&
+            rsettings.lyap_exp_matr_out_filename == rsettings.lyap_exp_matr_in_filename){
+        vcout << "Exponent matrix already saved to the same file" << endl;
+    }
+    else if(rsettings.save_exp_matrix){
+        vcout << (compress_tiles ? "Saving (compressed)... " : "Saving... ") << flush;
+        const int save_ret = compress_tiles ?
+            save_compressed_lyap_exp_matrix(lyap_exponents, rsettings.max_sector_size, rsettings.compression_level,
+                                            compressed_tiles, rsettings.lyap_exp_matr_out_filename) :
+            save_lyap_exp_matrix(lyap_exponents, rsettings.lyap_exp_matr_out_filename);
+        compressed_tiles.clear();
+
+        if(save_ret == 0){
             vcout << "done. Checking... " << flush;
 
-            if(load_lyap_exp_matrix(rsettings.lyap_exp_matr_out_filename) == lyap_exponents){
+            if(verify_lyap_exp_matrix(rsettings.lyap_exp_matr_out_filename) == 0){
                 vcout << "OK" << endl;
             }
             else{
@@ -161,112 +601,119 @@ png::image<png::rgb_pixel> alyr::render(){
         else{
             vcout << "ERROR" << endl;
             print_error("exponent matrix couldn't be saved");
-            //Return 1x1 empty image
-            return png::image<png::rgb_pixel>(1, 1);
+            return 2;
+        }
+    }
+
+    //Save the states of the orbits, to extend the render later
+    if(rsettings.save_orbits && !orbit_states.empty()){
+        vcout << "Saving orbit states... " << flush;
+        if(save_orbit_states(orbit_states, rsettings.lyap_exp_matr_out_filename) == 0){
+            vcout << "done" << endl;
+        }
+        else{
+            vcout << "ERROR" << endl;
         }
+        orbit_states = orbit_matrix_t();
     }
 
     //----------------------
     // STEP 3: color the exponents matrix
     //
-    // - statistical analysis of the exponents (find maximum, minimum)
+    // - statistical analysis of the exponents (find maximum, minimum and histogram), gathered while calculating them
+    //   or, for the sectors not calculated by this render, every sector in parallel
+    // - move the clamps to the required percentiles
     // - print results
-    // - allocate image in RAM
+    // - allocate images in RAM (the main one and the ones of the batch recolor)
     // - get pointer to renderer function
-    // - enqueue coloring jobs
-    // - print completion state
+    // - run the coloring jobs in the pool, reporting the progress from its own thread
     // - if required to draw crosshair, draw crosshair
+    // - save the images of the batch recolor
 
-    //Statistical analysis
+    //Statistical analysis, completed on the sectors not calculated by this render, every sector in parallel
     vcout << "Statistical analysis of the exponents:" << endl;
-    //Sort the exponents in positive and negative ones
-    size_t pos_inf_count = 0;
-    size_t neg_inf_count = 0;
-    size_t nan_count = 0;
-    vector<long double> abs_pos_exponents{};
-    vector<long double> abs_neg_exponents{};
-    for(size_t y = 0; y < isettings.image_height; ++y){
-        for(size_t x = 0; x < isettings.image_width; ++x){
-            if(isfinite(lyap_exponents[y][x])){
-                if(lyap_exponents[y][x] >= 0)
-                    abs_pos_exponents.push_back(lyap_exponents[y][x]);
-                else
-                    abs_neg_exponents.push_back(-lyap_exponents[y][x]);
-            }
-            else if(isnan(lyap_exponents[y][x]))
-                ++nan_count;
-            else{
-                if(lyap_exponents[y][x] > 0)
-                    ++pos_inf_count;
-                else
-                    ++neg_inf_count;
-            }
-        }
-    } 
-    vcout << "  - Positive count: " << abs_pos_exponents.size() << endl;
-    vcout << "  - Positive inf. : " << pos_inf_count << endl;
-    vcout << "  - Negative count: " << abs_neg_exponents.size() << endl;
-    vcout << "  - Negative inf. : " << neg_inf_count << endl;
-    vcout << "  - NaN count     : " << nan_count << endl;
-    sort(abs_pos_exponents.begin(), abs_pos_exponents.end());
-    sort(abs_neg_exponents.begin(), abs_neg_exponents.end());
-    vcout << "  - Pos. exponents : [" <<  abs_pos_exponents.front() << ", " << abs_pos_exponents.back()  << "] clamped in [" << rsettings.lower_pos_clamp << ", " << rsettings.upper_pos_clamp << "]" << endl;
-    vcout << "  - Neg. exponents : [" << -abs_neg_exponents.back() << ", " << -abs_neg_exponents.front() << "] clamped in [" << rsettings.lower_neg_clamp << ", " << rsettings.upper_neg_clamp << "]" << endl;
-    const long double max_pos = abs_pos_exponents.back();
-    const long double min_neg = -abs_neg_exponents.back();
+    //(gathered separately by every worker)
+    vector<expstats_t> worker_exp_stats(renderpool.num_workers());
+    renderpool.parallel_for(unscanned_sectors.size(), [&](const size_t& i, const size_t& worker){
+        const auto [start_x, start_y, end_x, end_y] = unscanned_sectors[i];
+        worker_exp_stats[worker].merge(block_exp_stats(start_x, start_y, end_x, end_y, lyap_exponents));
+    });
+    for(const auto& stats : worker_exp_stats)
+        exp_stats.merge(stats);
+
+    //Clamp the exponents at the required percentiles
+    clamp_at_percentiles(exp_stats, rsettings.pos_clamp_percentile, rsettings.neg_clamp_percentile,
+                         rsettings.upper_pos_clamp, rsettings.lower_neg_clamp);
+    for(auto& variant : recolor_variants)
+        clamp_at_percentiles(exp_stats, variant.pos_clamp_percentile, variant.neg_clamp_percentile,
+                             variant.upper_pos_clamp, variant.lower_neg_clamp);
+
+    vcout << "  - Positive count: " << exp_stats.pos_count << endl;
+    vcout << "  - Positive inf. : " << exp_stats.pos_inf_count << endl;
+    vcout << "  - Negative count: " << exp_stats.neg_count << endl;
+    vcout << "  - Negative inf. : " << exp_stats.neg_inf_count << endl;
+    vcout << "  - NaN count     : " << exp_stats.nan_count << endl;
+    if(exp_stats.pos_count != 0){
+        vcout << "  - Pos. exponents : [" << exp_stats.min_pos << ", " << exp_stats.max_pos << "] clamped in [" << rsettings.lower_pos_clamp << ", " << rsettings.upper_pos_clamp << "]" << endl;
+    }
+    if(exp_stats.neg_count != 0){
+        vcout << "  - Neg. exponents : [" << exp_stats.min_neg << ", " << exp_stats.max_neg << "] clamped in [" << rsettings.lower_neg_clamp << ", " << rsettings.upper_neg_clamp << "]" << endl;
+    }
 
     //If coloring should be skipped
     if(rsettings.skip_coloring){
         //Return 1x1 empty image
-        return png::image<png::rgb_pixel>(1, 1);
+        fractal_image = png::image<png::rgb_pixel>(1, 1);
+        return 0;
     }
     //Else color the image
     else{
-        //Allocate image of the fractal
-        vcout << "Allocating image in RAM... " << flush;
-        png::image<png::rgb_pixel> fractal_image(isettings.image_width, isettings.image_height);
+        //Colorings of the images: the main one first, then the ones of the batch recolor
+        vector<recolor_variant_t> variants{current_recolor_variant()};
+        variants.insert(variants.end(), recolor_variants.begin(), recolor_variants.end());
+
+        //Allocate images of the fractal
+        vcout << "Allocating " << variants.size() << (variants.size() == 1 ? " image" : " images") << " in RAM... " << flush;
+        vector<png::image<png::rgb_pixel>> fractal_images;
+        for(size_t i = 0; i < variants.size(); ++i)
+            fractal_images.emplace_back(isettings.image_width, isettings.image_height);
         vcout << "Done!" << endl;
 
         //Function pointer to the block renderer
         block_renderer_fn_ptr_t block_renderer_pointer = &block_renderer;
 
-        //Enqueue jobs
-        //For every sector
-        for(auto s : sectors){
-            size_t start_x = s[0];
-            size_t start_y = s[1];
-            size_t end_x   = s[2];
-            size_t end_y   = s[3];
-
-            //Enqueue a job to the renderpool
-            completed_sectors.emplace_back(
-                renderpool.enqueue(
-                    block_renderer_pointer,     //Block renderer
-                    start_x, start_y,           //(x,y) starting position
-                    end_x, end_y,               //(x,y) ending position
-                    max_pos,                    //Maximum positive exponent
-                    min_neg,                    //Minimum negative exponent
-                    ref(lyap_exponents),        //Reference to matrix of exponents
-                    ref(fractal_image)          //Reference to image to update pixels
-                )
-            );
-        }
-
-        const size_t total_sectors = sectors.size();
-        vcout << "Completed sectors (color): 0/" << total_sectors << "\r" << flush;
-        //Once all the jobs are enqueued, wait for all of them to finish
-        for(size_t i = 0; i < completed_sectors.size(); ++i){
-            completed_sectors[i].get();
-            vcout << "Completed sectors (color): " << i << "/" << total_sectors << "\r" << flush;
-        }
-        vcout << "Completed sectors (color): " << total_sectors << "/" << total_sectors << endl;
-        completed_sectors.clear();
+        //Colors of the exponents of every image, computed once for all the pixels
+        vector<color_lut_t> luts;
+        for(const auto& variant : variants)
+            luts.push_back(build_color_lut(variant, exp_stats));
+
+        //Progress of the coloring, reported by its own thread
+        progress_reporter_t progress("color", renderpool.num_workers(),
+                                     sectors.size(), isettings.image_width * isettings.image_height, 0, 0,
+                                     progress_console, progress_console_live, progress_json);
+
+        //Job of a sector: color it in all the images
+        renderpool.parallel_for(sectors.size(), [&](const size_t& i, const size_t& worker){
+            progress.begin_work(worker);
+            const auto [start_x, start_y, end_x, end_y] = sectors[i];
+            block_renderer_pointer(start_x, start_y, end_x, end_y, luts, lyap_exponents, fractal_images);
+            progress.end_work(worker, 1, (end_x - start_x) * (end_y - start_y), 0);
+        });
+        progress.finish();
 
         //Draw crosshair if required
-        if(csettings.draw_crosshair)
-            draw_crosshair(fractal_image);
+        for(size_t i = 0; i < variants.size(); ++i)
+            if(variants[i].csettings.draw_crosshair)
+                draw_crosshair(fractal_images[i]);
+
+        //Save the images of the batch recolor, the main one is returned
+        for(size_t i = 1; i < variants.size(); ++i){
+            vcout << "Saving image " << i << "/" << variants.size() - 1 << " of the batch recolor: " << variants[i].image_name << ".png" << endl;
+            fractal_images[i].write(variants[i].image_name + ".png");
+        }
 
-        return fractal_image;
+        fractal_image = std::move(fractal_images.front());
+        return 0;
     }
 }
 
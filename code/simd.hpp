@@ -0,0 +1,187 @@
+#ifndef SIMD_HPP_INCLUDED
+#define SIMD_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+//Width in bytes of the widest vector registers enabled at compile time.
+//0 means that no vector unit is available and the scalar kernels have to be used
+#ifndef ALYR_SIMD_BYTES
+    #if defined(__AVX512F__)
+        #define ALYR_SIMD_BYTES 64
+    #elif defined(__AVX__)
+        #define ALYR_SIMD_BYTES 32
+    #elif defined(__SSE2__) || defined(__ARM_NEON)
+        #define ALYR_SIMD_BYTES 16
+    #else
+        #define ALYR_SIMD_BYTES 0
+    #endif
+#endif
+
+#if ALYR_SIMD_BYTES > 0
+//Native vector types holding ALYR_SIMD_BYTES of T, and the masks returned by comparisons between them
+template<typename T>
+struct simd_native_types;
+
+template<>
+struct simd_native_types<float> {
+    typedef float   vec_t  __attribute__((vector_size(ALYR_SIMD_BYTES)));
+    typedef int32_t mask_t __attribute__((vector_size(ALYR_SIMD_BYTES)));
+};
+
+template<>
+struct simd_native_types<double> {
+    typedef double  vec_t  __attribute__((vector_size(ALYR_SIMD_BYTES)));
+    typedef int64_t mask_t __attribute__((vector_size(ALYR_SIMD_BYTES)));
+};
+
+//Pack of floating point values (float or double) processed together in the vector registers.
+//It behaves like a scalar in arithmetic expressions, so the maps in maps.hpp can be instantiated for it,
+//and a scalar used in its place is broadcast to every lane
+template<typename T>
+struct simd_vec {
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "simd_vec supports only float and double");
+
+    //Integer type with the same size of T, used for masks and bit manipulations
+    using int_t = std::conditional_t<sizeof(T) == 8, int64_t, int32_t>;
+
+    using native_t      = typename simd_native_types<T>::vec_t;
+    using native_mask_t = typename simd_native_types<T>::mask_t;
+
+    static constexpr size_t lanes = ALYR_SIMD_BYTES / sizeof(T);
+
+    native_t v;
+
+    simd_vec() = default;
+    simd_vec(const T& s) : v(native_t{} + s) {}
+    simd_vec(const native_t& _v) : v(_v) {}
+
+    T& operator[](const size_t& i) {return v[i];}
+    const T operator[](const size_t& i) const {return v[i];}
+
+    friend simd_vec operator+(const simd_vec& a, const simd_vec& b) {return a.v + b.v;}
+    friend simd_vec operator-(const simd_vec& a, const simd_vec& b) {return a.v - b.v;}
+    friend simd_vec operator*(const simd_vec& a, const simd_vec& b) {return a.v * b.v;}
+    friend simd_vec operator/(const simd_vec& a, const simd_vec& b) {return a.v / b.v;}
+    friend simd_vec operator-(const simd_vec& a) {return -a.v;}
+};
+
+//Select lane by lane between a (where the mask is set) and b
+template<typename T>
+inline simd_vec<T> simd_select(const typename simd_vec<T>::native_mask_t& mask, const simd_vec<T>& a, const simd_vec<T>& b){
+    return simd_vec<T>(mask ? a.v : b.v);
+}
+
+//Mask of the lanes containing a finite value (inf - inf and nan - nan are both nan)
+template<typename T>
+inline typename simd_vec<T>::native_mask_t simd_isfinite(const simd_vec<T>& x){
+    return (x.v - x.v) == 0;
+}
+
+//True if at least one lane of the mask is set
+template<typename T>
+inline bool simd_any(const T& mask){
+    for(size_t i = 0; i < sizeof(T) / sizeof(mask[0]); ++i)
+        if(mask[i])
+            return true;
+
+    return false;
+}
+
+template<typename T>
+inline simd_vec<T> simd_abs(const simd_vec<T>& x){
+    return simd_vec<T>(x.v < 0 ? -x.v : x.v);
+}
+
+//Split every positive lane of x in m * 2^e, with m in [1, 2).
+//Lanes containing 0, infinities or nan are returned unchanged, with e = 0
+template<typename T>
+inline simd_vec<T> simd_frexp(const simd_vec<T>& x, typename simd_vec<T>::native_mask_t& e){
+    using vec_t  = simd_vec<T>;
+    using int_t  = typename vec_t::int_t;
+    using mask_t = typename vec_t::native_mask_t;
+
+    constexpr int   mant_bits = std::numeric_limits<T>::digits - 1;
+    constexpr int_t exp_bias  = std::numeric_limits<T>::max_exponent - 1;
+    constexpr int_t mant_mask = (int_t{1} << mant_bits) - 1;
+    constexpr int_t one_bits  = exp_bias << mant_bits;
+
+    //Bring subnormals in the normal range, so that the exponent can be read from the bits
+    const mask_t subnormal = x.v < std::numeric_limits<T>::min();
+    const typename vec_t::native_t xs = subnormal ? x.v * static_cast<T>(18446744073709551616.0l) : x.v;
+
+    //Split exponent and mantissa
+    const mask_t bits = (mask_t)xs;
+    e = ((bits >> mant_bits) & ((exp_bias << 1) | 1)) - exp_bias;
+    e = subnormal ? e - 64 : e;
+    const mask_t m_bits = (bits & mant_mask) | one_bits;
+
+    const mask_t regular = simd_isfinite(x) & (x.v != 0);
+    e = regular ? e : 0;
+    return simd_vec<T>(regular ? (typename vec_t::native_t)m_bits : x.v);
+}
+
+//Natural logarithm of every lane.
+//x is split into 2^e * m with m in [sqrt(2)/2, sqrt(2)), then log(m) = 2*atanh(s) with s = (m-1)/(m+1),
+//whose series converges fast enough in that range to reach full precision of T with only multiplications
+//and additions, so the whole computation stays in the vector registers
+template<typename T>
+inline simd_vec<T> simd_log(const simd_vec<T>& x){
+    using vec_t  = simd_vec<T>;
+    using mask_t = typename vec_t::native_mask_t;
+
+    constexpr T     sqrt2     = static_cast<T>(1.41421356237309504880l);
+    constexpr T     ln2_hi    = static_cast<T>(0.693145751953125l);
+    constexpr T     ln2_lo    = static_cast<T>(1.42860682030941723212e-6l);
+
+    mask_t e;
+    typename vec_t::native_t m = simd_frexp(x, e).v;
+
+    const mask_t big = m > sqrt2;
+    m = big ? m * static_cast<T>(0.5) : m;
+    e = big ? e + 1 : e;
+
+    //log(m) = 2s * (1 + s^2/3 + s^4/5 + ...)
+    const vec_t s  = (vec_t(m) - T{1}) / (vec_t(m) + T{1});
+    const vec_t s2 = s * s;
+    vec_t poly;
+    if constexpr (std::is_same_v<T, double>){
+        poly = T{1}/23;
+        poly = poly * s2 + T{1}/21;
+        poly = poly * s2 + T{1}/19;
+        poly = poly * s2 + T{1}/17;
+        poly = poly * s2 + T{1}/15;
+        poly = poly * s2 + T{1}/13;
+    }
+    else{
+        poly = T{1}/13;
+    }
+    poly = poly * s2 + T{1}/11;
+    poly = poly * s2 + T{1}/9;
+    poly = poly * s2 + T{1}/7;
+    poly = poly * s2 + T{1}/5;
+    poly = poly * s2 + T{1}/3;
+    poly = poly * s2 + T{1};
+
+    const vec_t ef = __builtin_convertvector(e, typename vec_t::native_t);
+    vec_t ret = ef * ln2_hi + (ef * ln2_lo + T{2} * s * poly);
+
+    //Special values
+    ret.v = (x.v == 0) ? -std::numeric_limits<T>::infinity() : ret.v;
+    ret.v = (x.v == std::numeric_limits<T>::infinity()) ? x.v : ret.v;
+    ret.v = (x.v != x.v) ? x.v : ret.v;
+
+    return ret;
+}
+#endif
+
+//True if the vectorized kernels should be used for T.
+//With less than 4 lanes the overhead of the lane masking outweighs the gain over the scalar kernels
+template<typename T>
+constexpr bool simd_kernel_available(){
+    return (std::is_same_v<T, float> || std::is_same_v<T, double>) && (ALYR_SIMD_BYTES / sizeof(T) >= 4);
+}
+
+#endif
@@ -4,6 +4,11 @@
 #include <string>
 #include <vector>
 #include <complex>
+#include <limits>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 
 //Map type enum
 enum class mtype{
@@ -17,6 +22,30 @@ enum class rxtype{
     A, B, C
 };
 
+//Floating point types the exponent kernels can be instantiated for
+enum class ftype{
+    float32, float64, long_double, float128,
+    unknown
+};
+
+//How the kernels accumulate the logarithms of the derivatives
+enum class accumulation_mode{
+    log, product,
+    unknown
+};
+
+//Types the exponents can be stored with in the matrix of the exponents and in the saved files
+enum class storage_type{
+    long_double, float32, float16, int16,
+    unknown
+};
+
+//Order in which the sectors of the image are calculated and colored
+enum class sector_order{
+    row_major, morton, hilbert, center_out,
+    unknown
+};
+
 ////Renderer type enum
 //enum class rtype{
 //    basic,
@@ -25,7 +54,7 @@ enum class rxtype{
 
 //Coloring mode enum
 enum class coloring_mode{
-    binary, linear,
+    binary, linear, histeq,
     unknown
 };
 
@@ -87,72 +116,328 @@ struct colorsettings_t {
 
     bool draw_crosshair;
 
+    std::string batch_recolor_filename;
+
     colorsettings_t(
         coloring_mode _cmode = coloring_mode::linear,
         std::string _name_neg_palette = {"npalette"},
         std::string _name_pos_palette = {"ppalette"},
-        bool _draw_crosshair = false
+        bool _draw_crosshair = false,
+        std::string _batch_recolor_filename = {}
     ) :
     cmode(_cmode),
     name_neg_palette(_name_neg_palette),
     name_pos_palette(_name_pos_palette),
-    draw_crosshair(_draw_crosshair) {}
+    draw_crosshair(_draw_crosshair),
+    batch_recolor_filename(_batch_recolor_filename) {}
 };
 
 //Struct containing all the settings for the rendering of the fractal
 struct rendersettings_t {
     //rtype renderer_type;
+    ftype float_type;
+    accumulation_mode exp_accumulation;
+    storage_type exp_storage;
+    long double storage_scale;
 
     size_t max_iter;
     size_t transient_iter;
     size_t max_sector_size;
+    bool adaptive_sectors;
+    sector_order sectors_order;
     size_t max_threads;
+    bool pin_threads;
+    bool huge_pages;
+
+    long double cycle_tolerance;
+    long double convergence_tolerance;
+    size_t convergence_interval;
 
     bool save_exp_matrix;
+    bool map_exp_matrix;
+    int compression_level;
+    size_t checkpoint_interval;
+    size_t preview_interval;
+    bool resume_render;
+    bool save_orbits;
+    bool extend_orbits;
     bool load_exp_matrix;
+    bool verify_exp_matrix;
     bool skip_coloring;
 
     long double lower_pos_clamp;
     long double upper_pos_clamp;
     long double lower_neg_clamp;
     long double upper_neg_clamp;
+    long double pos_clamp_percentile;
+    long double neg_clamp_percentile;
 
     std::string lyap_exp_matr_out_filename;
     std::string lyap_exp_matr_in_filename;
+    std::string orbits_in_filename;
     
     rendersettings_t(
         //const rtype& _renderer_type = rtype::basic,
+        const ftype& _float_type = ftype::long_double,
+        const accumulation_mode& _exp_accumulation = accumulation_mode::log,
+        const storage_type& _exp_storage = storage_type::long_double,
+        const long double& _storage_scale = 1.0l / 2048,
         const size_t& _max_iter = 2000,
         const size_t& _transient_iter = 200,
         const size_t& _max_sector_size = 64,
+        const bool& _adaptive_sectors = true,
+        const sector_order& _sectors_order = sector_order::hilbert,
         const size_t& _max_threads = 1,
+        const bool& _pin_threads = false,
+        const bool& _huge_pages = false,
+        const long double& _cycle_tolerance = 0,
+        const long double& _convergence_tolerance = 0,
+        const size_t& _convergence_interval = 100,
         const bool& _save_matr = false,
+        const bool& _map_matr = false,
+        const int& _compression_level = 0,
+        const size_t& _checkpoint_interval = 0,
+        const size_t& _preview_interval = 0,
+        const bool& _resume_render = false,
+        const bool& _save_orbits = false,
+        const bool& _extend_orbits = false,
         const bool& _load_matr = false,
+        const bool& _verify_matr = false,
         const bool& _skip_coloring = false,
         const long double& _low_pos_clamp = 0,
         const long double& _up_pos_clamp = 10000,
         const long double& _low_neg_clamp = -10000,
         const long double& _up_neg_clamp = 0,
+        const long double& _pos_clamp_percentile = 100,
+        const long double& _neg_clamp_percentile = 100,
         const std::string& _out_matr_filename = "exponent_matrix",
-        const std::string& _in_matr_filename = "exponent_matrix"
+        const std::string& _in_matr_filename = "exponent_matrix",
+        const std::string& _in_orbits_filename = "exponent_matrix"
     ) :
     //renderer_type(_renderer_type),
+    float_type(_float_type),
+    exp_accumulation(_exp_accumulation),
+    exp_storage(_exp_storage),
+    storage_scale(_storage_scale),
     max_iter(_max_iter),
     transient_iter(_transient_iter),
     max_sector_size(_max_sector_size),
+    adaptive_sectors(_adaptive_sectors),
+    sectors_order(_sectors_order),
     max_threads(_max_threads),
+    pin_threads(_pin_threads),
+    huge_pages(_huge_pages),
+    cycle_tolerance(_cycle_tolerance),
+    convergence_tolerance(_convergence_tolerance),
+    convergence_interval(_convergence_interval),
     save_exp_matrix(_save_matr),
+    map_exp_matrix(_map_matr),
+    compression_level(_compression_level),
+    checkpoint_interval(_checkpoint_interval),
+    preview_interval(_preview_interval),
+    resume_render(_resume_render),
+    save_orbits(_save_orbits),
+    extend_orbits(_extend_orbits),
     load_exp_matrix(_load_matr),
+    verify_exp_matrix(_verify_matr),
     skip_coloring(_skip_coloring),
     lower_pos_clamp(_low_pos_clamp),
     upper_pos_clamp(_up_pos_clamp),
     lower_neg_clamp(_low_neg_clamp),
     upper_neg_clamp(_up_neg_clamp),
+    pos_clamp_percentile(_pos_clamp_percentile),
+    neg_clamp_percentile(_neg_clamp_percentile),
     lyap_exp_matr_out_filename(_out_matr_filename),
-    lyap_exp_matr_in_filename(_in_matr_filename)
+    lyap_exp_matr_in_filename(_in_matr_filename),
+    orbits_in_filename(_in_orbits_filename)
     {}
 };
 
+//Tile of the exponent matrix compressed for saving
+struct compressed_tile_t {
+    //Shuffled and deflated bytes of the exponents
+    std::string data;
+    //CRC-32 of the exponents before compression
+    uint32_t crc;
+
+    compressed_tile_t() : data(), crc(0) {}
+};
+
+//Struct containing statistics on the number of iterations performed on the pixels of a block
+struct iterstats_t {
+    size_t pixels;
+    size_t total_iter;
+    size_t min_iter;
+    size_t max_iter;
+
+    iterstats_t() :
+    pixels(0),
+    total_iter(0),
+    min_iter(std::numeric_limits<size_t>::max()),
+    max_iter(0) {}
+
+    //Account for a pixel on which iter iterations have been performed
+    void add(const size_t& iter){
+        ++pixels;
+        total_iter += iter;
+        min_iter = std::min(min_iter, iter);
+        max_iter = std::max(max_iter, iter);
+    }
+
+    //Account for all the pixels of another block
+    void merge(const iterstats_t& other){
+        pixels += other.pixels;
+        total_iter += other.total_iter;
+        min_iter = std::min(min_iter, other.min_iter);
+        max_iter = std::max(max_iter, other.max_iter);
+    }
+};
+
+//Statistics of the exponents of a region of the matrix, which can be merged with those of other regions.
+//The absolute values of the finite exponents of each sign are also counted in a histogram with logarithmic bins,
+//from 10^hist_min_decade to 10^hist_max_decade, used to estimate their percentiles
+struct expstats_t {
+    static constexpr int    hist_min_decade      = -12;
+    static constexpr int    hist_max_decade      = 4;
+    static constexpr size_t hist_bins_per_decade = 32;
+    static constexpr size_t hist_bins            = (hist_max_decade - hist_min_decade) * hist_bins_per_decade;
+
+    //Finite exponents (0 is counted as positive), infinities and NaNs
+    size_t pos_count;
+    size_t neg_count;
+    size_t pos_inf_count;
+    size_t neg_inf_count;
+    size_t nan_count;
+
+    //Range of the finite positive exponents and of the finite negative exponents
+    long double min_pos;
+    long double max_pos;
+    long double min_neg;
+    long double max_neg;
+
+    std::array<uint64_t, hist_bins> pos_hist;
+    std::array<uint64_t, hist_bins> neg_hist;
+
+    expstats_t() :
+    pos_count(0),
+    neg_count(0),
+    pos_inf_count(0),
+    neg_inf_count(0),
+    nan_count(0),
+    min_pos(std::numeric_limits<long double>::infinity()),
+    max_pos(-std::numeric_limits<long double>::infinity()),
+    min_neg(std::numeric_limits<long double>::infinity()),
+    max_neg(-std::numeric_limits<long double>::infinity()),
+    pos_hist{},
+    neg_hist{} {}
+
+    //Bin of the histogram of an absolute value, values out of the range of the histogram go to the first or the last bin
+    static size_t hist_bin(const long double& abs_exp){
+        const long double pos = (std::log10(abs_exp) - hist_min_decade) * hist_bins_per_decade;
+        if(!(pos > 0))
+            return 0;
+        return std::min(static_cast<size_t>(pos), hist_bins - 1);
+    }
+
+    //Account for the exponent of a pixel
+    void add(const long double& lyap_exp){
+        if(std::isfinite(lyap_exp)){
+            if(lyap_exp >= 0){
+                ++pos_count;
+                min_pos = std::min(min_pos, lyap_exp);
+                max_pos = std::max(max_pos, lyap_exp);
+                ++pos_hist[hist_bin(lyap_exp)];
+            }
+            else{
+                ++neg_count;
+                min_neg = std::min(min_neg, lyap_exp);
+                max_neg = std::max(max_neg, lyap_exp);
+                ++neg_hist[hist_bin(-lyap_exp)];
+            }
+        }
+        else if(std::isnan(lyap_exp))
+            ++nan_count;
+        else if(lyap_exp > 0)
+            ++pos_inf_count;
+        else
+            ++neg_inf_count;
+    }
+
+    //Account for all the pixels of another region
+    void merge(const expstats_t& other){
+        pos_count += other.pos_count;
+        neg_count += other.neg_count;
+        pos_inf_count += other.pos_inf_count;
+        neg_inf_count += other.neg_inf_count;
+        nan_count += other.nan_count;
+        min_pos = std::min(min_pos, other.min_pos);
+        max_pos = std::max(max_pos, other.max_pos);
+        min_neg = std::min(min_neg, other.min_neg);
+        max_neg = std::max(max_neg, other.max_neg);
+        for(size_t b = 0; b < hist_bins; ++b){
+            pos_hist[b] += other.pos_hist[b];
+            neg_hist[b] += other.neg_hist[b];
+        }
+    }
+
+    //Estimate of the given percentile (in [0, 100]) of the absolute values of the finite exponents of a sign,
+    //interpolating logarithmically inside the bin it falls into. Returns 0 if there are no such exponents
+    long double abs_percentile(const bool& negative, const long double& percentile) const {
+        const auto& hist  = negative ? neg_hist : pos_hist;
+        const size_t count = negative ? neg_count : pos_count;
+        const long double min_abs = negative ? -max_neg : min_pos;
+        const long double max_abs = negative ? -min_neg : max_pos;
+        if(count == 0)
+            return 0;
+
+        const long double rank = std::clamp(percentile, 0.0l, 100.0l) / 100 * static_cast<long double>(count);
+        uint64_t cumulative = 0;
+        for(size_t b = 0; b < hist_bins; ++b){
+            if(hist[b] == 0 || static_cast<long double>(cumulative + hist[b]) < rank){
+                cumulative += hist[b];
+                continue;
+            }
+
+            const long double fraction = (rank - static_cast<long double>(cumulative)) / static_cast<long double>(hist[b]);
+            const long double decade = hist_min_decade + (static_cast<long double>(b) + fraction) / hist_bins_per_decade;
+            return std::clamp(std::pow(10.0l, decade), min_abs, max_abs);
+        }
+        return max_abs;
+    }
+};
+
+//Summary of a block of pixels whose exponents have been calculated: iterations performed and statistics of the exponents
+struct blockstats_t {
+    iterstats_t iters;
+    expstats_t exps;
+
+    //Account for a pixel on which iter iterations have been performed, with its exponent as stored in the matrix
+    void add(const size_t& iter, const long double& lyap_exp){
+        iters.add(iter);
+        exps.add(lyap_exp);
+    }
+
+    //Account for all the pixels of another block
+    void merge(const blockstats_t& other){
+        iters.merge(other.iters);
+        exps.merge(other.exps);
+    }
+};
+
+//State of the orbit of a pixel at the end of the render, saved to extend it to more iterations later
+struct orbit_state_t {
+    //Last element of the orbit
+    std::complex<long double> xn;
+    //Sum of the logarithms of the absolute values of the derivatives, from the end of the transient on.
+    //For finished orbits, the exponent of the pixel
+    long double log_sum;
+    //Iterations performed on the orbit
+    uint64_t iter_count;
+    //Non zero if more iterations can't change the exponent of the pixel
+    //(the exponent isn't finite, or the orbit has been classified as periodic/divergent or has converged)
+    uint64_t finished;
+};
+
 //Struct containing information of a single rendered pixel
 //struct pixel_t{
 //    unsigned char red, green, blue, alpha;
@@ -173,17 +458,21 @@ struct consolesettings_t {
     int colored_output;
     int suppress_warnings;
     int suppress_errors;
+    //File to write the progress of the render to as JSON lines, empty for none
+    std::string progress_json_filename;
 
     consolesettings_t(
         const int& _verbose_output = 0,
         const int& _colored_output = 0,
         const int& _suppress_warnings = 0,
-        const int& _suppress_errors = 0
+        const int& _suppress_errors = 0,
+        const std::string& _progress_json_filename = ""
     ) :
     verbose_output(_verbose_output),
     colored_output(_colored_output),
     suppress_warnings(_suppress_warnings),
-    suppress_errors(_suppress_errors) {}
+    suppress_errors(_suppress_errors),
+    progress_json_filename(_progress_json_filename) {}
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,220 @@
+#ifndef WORK_STEALING_POOL_HPP_INCLUDED
+#define WORK_STEALING_POOL_HPP_INCLUDED
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<pthread.h>) && __has_include(<sched.h>)
+    #include <pthread.h>
+    #include <sched.h>
+    #define ALYR_AFFINITY 1
+#else
+    #define ALYR_AFFINITY 0
+#endif
+
+//Pool of threads running parallel-for loops over ranges of indexes (the sectors of a render).
+//When a loop starts, every worker gets an equal contiguous part of the range, and takes its indexes one at a time
+//from the front; a worker whose part is exhausted steals the back half of the part of another worker.
+//The parts are single atomic words, so taking or stealing indexes costs one compare-and-swap, without locks
+//and without allocating anything per index; the mutex is only used to start the loops and wait for them.
+//The pool runs one loop at a time
+class work_stealing_pool_t {
+public:
+    //Maximum number of indexes of a loop
+    static constexpr size_t max_loop_size = UINT32_MAX;
+
+    explicit work_stealing_pool_t(const size_t& num_threads) :
+        ranges(num_threads == 0 ? 1 : num_threads),
+        body_ptr(nullptr), body_fn(nullptr),
+        completed_count(0), busy_workers(0), generation(0), stop(false)
+    {
+        for(size_t w = 0; w < ranges.size(); ++w)
+            workers.emplace_back([this, w](){worker_loop(w);});
+    }
+
+    ~work_stealing_pool_t(){
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stop = true;
+        }
+        start_cv.notify_all();
+        for(auto& worker : workers)
+            worker.join();
+    }
+
+    work_stealing_pool_t(const work_stealing_pool_t&) = delete;
+    work_stealing_pool_t& operator=(const work_stealing_pool_t&) = delete;
+
+    //Number of workers, the second argument of the loop bodies is in [0, num_workers())
+    size_t num_workers() const {return workers.size();}
+
+    //Pin every worker to its own core, taking in order the cores the process is allowed to run on
+    //(round-robin if the workers are more than them). The workers with adjacent parts of the loops
+    //get adjacent cores, which are usually on the same NUMA node.
+    //Returns 0 on success
+    int pin_workers(){
+#if ALYR_AFFINITY
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if(::sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            return 1;
+
+        std::vector<int> cpus;
+        for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if(CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        if(cpus.empty())
+            return 1;
+
+        int ret_val = 0;
+        for(size_t w = 0; w < workers.size(); ++w){
+            cpu_set_t core;
+            CPU_ZERO(&core);
+            CPU_SET(cpus[w % cpus.size()], &core);
+            if(::pthread_setaffinity_np(workers[w].native_handle(), sizeof(core), &core) != 0)
+                ret_val = 1;
+        }
+        return ret_val;
+#else
+        return 1;
+#endif
+    }
+
+    //Start calling body(index, worker) for every index in [0, n) on the workers, and return without waiting.
+    //n can be at most max_loop_size. The body must stay alive until the loop is completed
+    template<typename F>
+    void start(const size_t& n, F& body){
+        assert(n <= max_loop_size && "the loops of the pool can have at most 2^32 - 1 indexes");
+        wait();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        body_ptr = const_cast<void*>(static_cast<const void*>(&body));
+        body_fn  = [](void* b, const size_t& index, const size_t& worker){(*static_cast<F*>(b))(index, worker);};
+        completed_count.store(0, std::memory_order_relaxed);
+        for(size_t w = 0; w < ranges.size(); ++w)
+            ranges[w].value.store(pack(n * w / ranges.size(), n * (w + 1) / ranges.size()), std::memory_order_relaxed);
+        busy_workers = ranges.size();
+        ++generation;
+        lock.unlock();
+        start_cv.notify_all();
+    }
+
+    //Wait for the loop to be completed, or until the deadline.
+    //Returns true if the loop has been completed
+    bool wait_until(const std::chrono::steady_clock::time_point& deadline){
+        std::unique_lock<std::mutex> lock(mutex);
+        return done_cv.wait_until(lock, deadline, [this](){return busy_workers == 0;});
+    }
+
+    //Wait for the loop to be completed
+    void wait(){
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this](){return busy_workers == 0;});
+    }
+
+    //Number of indexes of the current loop already completed
+    size_t completed() const {return completed_count.load(std::memory_order_relaxed);}
+
+    //Call body(index, worker) for every index in [0, n) and wait for all of them (n at most max_loop_size)
+    template<typename F>
+    void parallel_for(const size_t& n, F&& body){
+        start(n, body);
+        wait();
+    }
+
+private:
+    //Part of the range of a worker, as [begin, end) packed in a single word: both of them must fit in 32 bits,
+    //which limits the indexes of a loop to max_loop_size
+    struct alignas(64) range_t {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static uint64_t pack(const uint64_t& begin, const uint64_t& end){return (begin << 32) | end;}
+    static uint64_t begin_of(const uint64_t& r){return r >> 32;}
+    static uint64_t end_of(const uint64_t& r){return r & 0xFFFFFFFF;}
+
+    //Take the first index of the part of a worker, returns false if it's empty
+    bool pop_front(const size_t& w, size_t& index){
+        uint64_t r = ranges[w].value.load(std::memory_order_acquire);
+        while(begin_of(r) < end_of(r)){
+            if(ranges[w].value.compare_exchange_weak(r, pack(begin_of(r) + 1, end_of(r)), std::memory_order_acq_rel)){
+                index = begin_of(r);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //Steal the back half of the part of another worker into the (empty) part of worker w, returns false if all are empty
+    bool steal(const size_t& w){
+        for(size_t i = 1; i < ranges.size(); ++i){
+            const size_t victim = (w + i) % ranges.size();
+            uint64_t r = ranges[victim].value.load(std::memory_order_acquire);
+            while(begin_of(r) < end_of(r)){
+                const uint64_t middle = begin_of(r) + (end_of(r) - begin_of(r)) / 2;
+                if(ranges[victim].value.compare_exchange_weak(r, pack(begin_of(r), middle), std::memory_order_acq_rel)){
+                    ranges[w].value.store(pack(middle, end_of(r)), std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(const size_t& w){
+        uint64_t seen_generation = 0;
+        for(;;){
+            void* body;
+            void (*fn)(void*, const size_t&, const size_t&);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_cv.wait(lock, [&](){return stop || generation != seen_generation;});
+                if(stop)
+                    return;
+                seen_generation = generation;
+                body = body_ptr;
+                fn = body_fn;
+            }
+
+            //Run the indexes of the own part, then the stolen ones, until there's nothing left to steal
+            size_t index;
+            while(pop_front(w, index) || (steal(w) && pop_front(w, index))){
+                fn(body, index, w);
+                completed_count.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            bool last = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                last = (--busy_workers == 0);
+            }
+            if(last)
+                done_cv.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<range_t> ranges;
+
+    //Current loop
+    void* body_ptr;
+    void (*body_fn)(void*, const size_t&, const size_t&);
+    std::atomic<size_t> completed_count;
+
+    //Synchronization of the start and the end of the loops
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    size_t busy_workers;
+    uint64_t generation;
+    bool stop;
+};
+
+#endif
@@ -39,7 +39,26 @@ int main(int argc, char** argv){
             break;
     }
 
-    auto img = alyr::render();
+    //Load the variants of the batch recolor
+    switch(alyr::load_recolor_batch()){
+        //Success
+        case 0:
+            break;
+
+        //Warnings
+        case 1:
+            break;
+
+        //Anything else
+        default:
+            return EXIT_FAILURE;
+            break;
+    }
+
+    //Render the image, the errors have already been printed
+    png::image<png::rgb_pixel> img;
+    if(alyr::render(img) != 0)
+        return EXIT_FAILURE;
 
     img.write(alyr::internals::isettings.image_name + ".png");
 
@@ -0,0 +1,87 @@
+#include "alyr.hpp"
+#include "maps.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+
+using namespace alyr::internals;
+
+//Grid of pixels of the test, with ra and rb up to 4.5 so that some of the orbits diverge
+static constexpr size_t grid_width  = 64;
+static constexpr size_t grid_height = 48;
+
+//Exponents of all the pixels of the grid, calculated by an exponent calculator
+static lyap_exp_matrix_t grid_exps(const block_exp_calc_fn_ptr_t& block_exp_calc_pointer){
+    lyap_exp_matrix_t exps(grid_height, grid_width, storage_type::long_double, 1);
+    block_exp_calc_pointer(grid_width, grid_height, 0, 0, grid_width, grid_height, rsettings.max_iter, exps, nullptr);
+    return exps;
+}
+
+//Compare the exponents accumulated as products with the ones accumulated as logarithms by a kernel for the type T:
+//the same pixels have to be infinite or nan, and the finite exponents can differ by at most the bound documented
+//for --exp-accumulation, (iterations) x (epsilon of T) x |exponent|. Returns the number of pixels out of the bound
+template<typename T>
+static size_t compare_accumulation(const std::string& kernel_name,
+                                   const block_exp_calc_fn_ptr_t& log_calc, const block_exp_calc_fn_ptr_t& product_calc){
+    const lyap_exp_matrix_t log_exps     = grid_exps(log_calc);
+    const lyap_exp_matrix_t product_exps = grid_exps(product_calc);
+    const long double rel_tolerance = static_cast<long double>(rsettings.max_iter) * std::numeric_limits<T>::epsilon();
+
+    size_t failures = 0;
+    for(size_t y = 0; y < grid_height; ++y){
+        for(size_t x = 0; x < grid_width; ++x){
+            const long double log_exp     = log_exps.get(y, x);
+            const long double product_exp = product_exps.get(y, x);
+
+            bool matching;
+            if(std::isnan(log_exp) || std::isnan(product_exp))
+                matching = std::isnan(log_exp) && std::isnan(product_exp);
+            else if(std::isinf(log_exp) || std::isinf(product_exp))
+                matching = log_exp == product_exp;
+            else
+                matching = std::fabs(product_exp - log_exp) <= rel_tolerance * std::fabs(log_exp);
+
+            if(!matching && failures++ < 10)
+                std::cout << "[FAIL] : " << kernel_name << ", pixel (" << x << ", " << y << "): "
+                          << "log " << log_exp << ", product " << product_exp << "\n";
+        }
+    }
+
+    std::cout << (failures == 0 ? "[PASS] : " : "[FAIL] : ") << kernel_name << "\n";
+    return failures;
+}
+
+//Compare the accumulation modes of the scalar and, if available, the vectorized kernels for the type T
+template<typename T>
+static size_t test_type(const std::string& type_name){
+    size_t failures = compare_accumulation<T>(type_name + ", scalar",
+        &block_exp_calculator_real<T, accumulation_mode::log,     2, &logmap<T>, &logmap_der<T>>,
+        &block_exp_calculator_real<T, accumulation_mode::product, 2, &logmap<T>, &logmap_der<T>>);
+
+#if ALYR_SIMD_BYTES > 0
+    if constexpr (simd_kernel_available<T>())
+        failures += compare_accumulation<T>(type_name + ", SIMD",
+            &block_exp_calculator_simd<T, accumulation_mode::log,     2, &logmap<simd_vec<T>>, &logmap_der<simd_vec<T>>>,
+            &block_exp_calculator_simd<T, accumulation_mode::product, 2, &logmap<simd_vec<T>>, &logmap_der<simd_vec<T>>>);
+#endif
+
+    return failures;
+}
+
+int main(){
+    fsettings.max_ra = 4.5l;
+    fsettings.max_rb = 4.5l;
+    rx_sequence = {rxtype::A, rxtype::B};
+    rsettings.max_iter = 1000;
+    rsettings.transient_iter = 200;
+
+    size_t failures = 0;
+    failures += test_type<float>("float");
+    failures += test_type<double>("double");
+    failures += test_type<long double>("long double");
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
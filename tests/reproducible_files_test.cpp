@@ -0,0 +1,102 @@
+#include "alyr.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace alyr::internals;
+
+//Bytes of a file, empty if it can't be read
+static std::vector<char> file_bytes(const std::string& filename){
+    std::ifstream in_file(filename, std::ios::in | std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in_file), std::istreambuf_iterator<char>());
+}
+
+//Render the exponents (without coloring them) and save them with the given name, returns 0 on success
+static int render_to(const std::string& filename){
+    rsettings.lyap_exp_matr_out_filename = filename;
+    png::image<png::rgb_pixel> image;
+    return alyr::render(image);
+}
+
+//Compare a file written by two renders with the same settings, which have to be identical byte by byte.
+//Returns 1 if they differ
+static int compare_files(const std::string& first, const std::string& second){
+    const std::vector<char> first_bytes  = file_bytes(first);
+    const std::vector<char> second_bytes = file_bytes(second);
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+
+    if(first_bytes.empty() || first_bytes != second_bytes){
+        std::cout << "[FAIL] : " << first << " and " << second << " differ\n";
+        return 1;
+    }
+    std::cout << "[PASS] : " << first << " and " << second << " are identical\n";
+    return 0;
+}
+
+//Save the same states of the orbits twice, with different garbage in their padding bytes,
+//which has to be left out of the files. Returns 1 if the files differ
+static int compare_poisoned_orbits(){
+    const unsigned char poisons[2] = {0x00, 0xa5};
+    for(size_t i = 0; i < 2; ++i){
+        orbit_matrix_t states(2, 3, matrix_alloc::filled);
+        for(size_t y = 0; y < states.rows(); ++y){
+            for(size_t x = 0; x < states.cols(); ++x){
+                //Only the bytes of the values are written, the padding ones keep the garbage
+                orbit_state_t& state = states[y][x];
+                std::memset(static_cast<void*>(&state), poisons[i], sizeof(state));
+                const long double values[3] = {0.25l * x, -0.5l * y, -1.0l / (1 + x + y)};
+                std::memcpy(reinterpret_cast<unsigned char*>(&state.xn), &values[0], long_double_value_size);
+                std::memcpy(reinterpret_cast<unsigned char*>(&state.xn) + sizeof(long double), &values[1], long_double_value_size);
+                std::memcpy(&state.log_sum, &values[2], long_double_value_size);
+                state.iter_count = 100 * y + x;
+                state.finished   = x % 2;
+            }
+        }
+        if(save_orbit_states(states, "reproducible_test_" + std::to_string(i + 1)) != 0)
+            return 1;
+    }
+
+    return compare_files("reproducible_test_1.orbits", "reproducible_test_2.orbits");
+}
+
+int main(){
+    alyr::init();
+
+    //Exponents and states of the orbits stored as long double, whose padding bytes must not reach the files,
+    //calculated by a few workers with their own stacks
+    isettings.image_width  = 200;
+    isettings.image_height = 150;
+    rsettings.max_threads = 4;
+    rsettings.max_iter = 300;
+    rsettings.float_type  = ftype::long_double;
+    rsettings.exp_storage = storage_type::long_double;
+    rsettings.save_exp_matrix = true;
+    rsettings.save_orbits     = true;
+    rsettings.skip_coloring   = true;
+
+    int failures = 0;
+
+    //Files written at the end of the render, mapped during the render and compressed
+    const std::vector<std::pair<bool, int>> file_kinds = {{false, 0}, {true, 0}, {false, 6}};
+    for(const auto& [map_file, compression_level] : file_kinds){
+        rsettings.map_exp_matrix    = map_file;
+        rsettings.compression_level = compression_level;
+        if(render_to("reproducible_test_1") != 0 || render_to("reproducible_test_2") != 0)
+            return EXIT_FAILURE;
+
+        failures += compare_files("reproducible_test_1.expbin", "reproducible_test_2.expbin");
+        failures += compare_files("reproducible_test_1.orbits", "reproducible_test_2.orbits");
+    }
+
+    failures += compare_poisoned_orbits();
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}